@@ -41,6 +41,8 @@ public:
 
   virtual double calculateScore(const std::map<std::string, double>& pose) override;
 
+  virtual reach::plugins::EvaluationBasePtr clone() const override;
+
 private:
   std::tuple<std::vector<double>, std::vector<double>> getJointLimits();
 
@@ -43,6 +43,8 @@ public:
 
   virtual double calculateScore(const std::map<std::string, double>& pose) override;
 
+  virtual reach::plugins::EvaluationBasePtr clone() const override;
+
 protected:
   virtual double calculateScore(const Eigen::MatrixXd& jacobian_singular_values);
 
@@ -58,6 +60,8 @@ public:
   using ManipulabilityMoveIt::ManipulabilityMoveIt;
   virtual bool initialize(XmlRpc::XmlRpcValue& config) override;
 
+  virtual reach::plugins::EvaluationBasePtr clone() const override;
+
   virtual double calculateScore(const Eigen::MatrixXd& jacobian_singular_values) override;
 
 protected:
@@ -69,6 +73,9 @@ class ManipulabilityRatio : public ManipulabilityMoveIt
 {
 public:
   using ManipulabilityMoveIt::ManipulabilityMoveIt;
+
+  virtual reach::plugins::EvaluationBasePtr clone() const override;
+
   virtual double calculateScore(const Eigen::MatrixXd& jacobian_singular_values) override;
 };
 
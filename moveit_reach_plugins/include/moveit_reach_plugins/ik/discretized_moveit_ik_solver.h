@@ -17,14 +17,35 @@
 #define MOVEIT_REACH_PLUGINS_IK_DISCRETIZED_MOVEIT_IK_SOLVER_H
 
 #include "moveit_ik_solver.h"
+#include <reach_core/utils/parallel_utils.h>
 
 namespace moveit_reach_plugins
 {
 namespace ik
 {
+/**
+ * @brief The DiscretizedMoveItIKSolver class solves IK for a target rotated about its Z-axis in increments of the
+ * discretization angle, and returns the solution with the best score. The rotated targets can be solved concurrently,
+ * with one MoveIt IK solver (and planning scene) per thread. Either all of the rotated targets are solved, or only a
+ * coarse subset of them after which the search is refined around the best ones (see SearchMode). The rotated targets
+ * are solved either from the input seed, or in continuation mode, in order from the solution of the previous rotation
+ */
 class DiscretizedMoveItIKSolver : public MoveItIKSolver
 {
 public:
+  /**
+   * @brief The SearchMode enum defines how the rotated targets are searched
+   */
+  enum class SearchMode
+  {
+    // Solve every rotated target
+    EXHAUSTIVE,
+    // Solve the rotated targets at the coarse discretization angle, then repeatedly solve the targets halfway between
+    // each of the best ones and the closest solved targets on either side of it until the discretization angle is
+    // reached. If none of the coarse targets is feasible, all of the rotated targets are solved
+    COARSE_TO_FINE
+  };
+
   DiscretizedMoveItIKSolver();
 
   virtual bool initialize(XmlRpc::XmlRpcValue& config) override;
@@ -33,8 +54,73 @@ public:
                                                   const std::map<std::string, double>& seed,
                                                   std::vector<double>& solution) override;
 
+  virtual reach::plugins::IKSolverBasePtr clone() const override;
+
 protected:
+  /**
+   * @brief createSweepSolvers creates the solvers used by the threads of the sweep other than the calling thread
+   * @return false if the solvers could not be created
+   */
+  bool createSweepSolvers();
+
+  /**
+   * @brief refineDiscretizations repeatedly solves the rotations halfway between each of the best solved rotations and
+   * the closest solved rotations on either side of it, until the best rotations have no unsolved neighbors
+   * @param target
+   * @param seed
+   * @param solved flags of the rotations that have been solved
+   * @param scores scores of the solved rotations, or none if IK failed
+   * @param solutions joint positions of the solved rotations
+   */
+  void refineDiscretizations(const Eigen::Isometry3d& target, const std::map<std::string, double>& seed,
+                             std::vector<bool>& solved, std::vector<boost::optional<double>>& scores,
+                             std::vector<std::vector<double>>& solutions);
+
+  /**
+   * @brief solveDiscretizations solves IK for the rotated targets with the input indices that have not been solved yet
+   * @param indices indices of the rotations, on the interval [0, n_discretizations_)
+   * @param target
+   * @param seeds seed of each rotation; in continuation mode only the first rotation solved by each thread uses its
+   * seed, and the others are seeded with the previous feasible solution
+   * @param solved flags of the rotations that have been solved, updated with the input rotations
+   * @param scores scores of the solved rotations, or none if IK failed
+   * @param solutions joint positions of the solved rotations
+   */
+  void solveDiscretizations(const std::vector<int>& indices, const Eigen::Isometry3d& target,
+                            const std::vector<std::map<std::string, double>>& seeds, std::vector<bool>& solved,
+                            std::vector<boost::optional<double>>& scores, std::vector<std::vector<double>>& solutions);
+
+  /**
+   * @brief toSeed converts the joint positions of a solution to a seed state
+   * @param solution
+   * @return
+   */
+  std::map<std::string, double> toSeed(const std::vector<double>& solution) const;
+
   double dt_;
+
+  // Number of rotated targets per target
+  int n_discretizations_ = 1;
+
+  SearchMode search_mode_ = SearchMode::EXHAUSTIVE;
+
+  // Seed each rotated target with the solution of the previous feasible rotation rather than the input seed
+  bool continuation_ = false;
+
+  // Number of rotations between the rotated targets solved first in the coarse-to-fine search
+  int coarse_step_ = 1;
+
+  // Number of best rotations around which the coarse-to-fine search is refined
+  int n_refined_rotations_ = 2;
+
+  // Number of threads over which the rotated targets are solved; clones always use a single thread
+  int n_threads_ = 1;
+
+  // Solvers of the threads of the sweep, other than the calling thread which uses this solver
+  std::vector<boost::shared_ptr<MoveItIKSolver>> sweep_solvers_;
+
+  // Threads of the sweep, of which the calling thread is the first
+  reach::utils::ThreadPoolPtr sweep_threads_;
 };
 
 }  // namespace ik
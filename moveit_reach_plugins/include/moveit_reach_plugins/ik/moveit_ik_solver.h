@@ -19,6 +19,8 @@
 #include <reach_core/plugins/ik_solver_base.h>
 #include <reach_core/plugins/evaluation_base.h>
 #include <pluginlib/class_loader.h>
+#include <boost/function.hpp>
+#include <memory>
 
 namespace moveit
 {
@@ -46,6 +48,8 @@ class MoveItIKSolver : public reach::plugins::IKSolverBase
 public:
   MoveItIKSolver();
 
+  virtual ~MoveItIKSolver();
+
   virtual bool initialize(XmlRpc::XmlRpcValue& config) override;
 
   virtual boost::optional<double> solveIKFromSeed(const Eigen::Isometry3d& target,
@@ -54,7 +58,17 @@ public:
 
   virtual std::vector<std::string> getJointNames() const override;
 
+  virtual reach::plugins::IKSolverBasePtr clone() const override;
+
 protected:
+  /**
+   * @brief copyTo copies the state of this solver into the input solver, giving it its own planning scene and
+   * evaluation plugin
+   * @param other
+   * @return false if the evaluation plugin could not be cloned
+   */
+  bool copyTo(MoveItIKSolver& other) const;
+
   bool isIKSolutionValid(moveit::core::RobotState* state, const moveit::core::JointModelGroup* jmg,
                          const double* ik_solution) const;
 
@@ -75,6 +89,18 @@ protected:
   std::string collision_mesh_frame_;
 
   std::vector<std::string> touch_links_;
+
+  // Robot state and buffers reused by the solves of this solver, such that a solve does not allocate memory once they
+  // have grown to size. Each worker of the reach study has its own solver, so they are never shared between threads
+  std::unique_ptr<moveit::core::RobotState> state_;
+
+  std::vector<double> seed_buffer_;
+
+  std::map<std::string, double> solution_buffer_;
+
+  // Validity callback of the IK solver, bound to this solver once rather than on every solve
+  boost::function<bool(moveit::core::RobotState*, const moveit::core::JointModelGroup*, const double*)>
+      validity_callback_;
 };
 
 }  // namespace ik
@@ -73,7 +73,7 @@ visualization_msgs::Marker makeMarker(const std::vector<geometry_msgs::Point>& p
  * @brief validateInputMap
  * @param input
  * @param joint_names
- * @param revised_input
+ * @param revised_input resized in place, such that its memory is reused; its contents are unspecified on failure
  * @return
  */
 bool transcribeInputMap(const std::map<std::string, double>& input, const std::vector<std::string>& joint_names,
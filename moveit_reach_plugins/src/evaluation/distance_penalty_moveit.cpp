@@ -114,6 +114,13 @@ double DistancePenaltyMoveIt::calculateScore(const std::map<std::string, double>
   return std::pow((dist / dist_threshold_), exponent_);
 }
 
+reach::plugins::EvaluationBasePtr DistancePenaltyMoveIt::clone() const
+{
+  boost::shared_ptr<DistancePenaltyMoveIt> copy(new DistancePenaltyMoveIt(*this));
+  copy->scene_ = planning_scene::PlanningScene::clone(scene_);
+  return copy;
+}
+
 }  // namespace evaluation
 }  // namespace moveit_reach_plugins
 
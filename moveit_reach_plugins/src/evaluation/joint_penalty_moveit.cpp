@@ -18,6 +18,7 @@
 #include <moveit/robot_model/joint_model_group.h>
 #include <moveit/common_planning_interface_objects/common_objects.h>
 #include <xmlrpcpp/XmlRpcException.h>
+#include <boost/make_shared.hpp>
 
 namespace moveit_reach_plugins
 {
@@ -83,6 +84,11 @@ double JointPenaltyMoveIt::calculateScore(const std::map<std::string, double>& p
   return score.mean();
 }
 
+reach::plugins::EvaluationBasePtr JointPenaltyMoveIt::clone() const
+{
+  return boost::make_shared<JointPenaltyMoveIt>(*this);
+}
+
 std::tuple<std::vector<double>, std::vector<double>> JointPenaltyMoveIt::getJointLimits()
 {
   std::vector<double> max, min;
@@ -18,6 +18,7 @@
 #include <moveit/common_planning_interface_objects/common_objects.h>
 #include <moveit/robot_model/joint_model_group.h>
 
+#include <boost/make_shared.hpp>
 #include <numeric>
 #include <xmlrpcpp/XmlRpcException.h>
 
@@ -160,11 +161,21 @@ double ManipulabilityMoveIt::calculateScore(const std::map<std::string, double>&
   return calculateScore(singular_values);
 }
 
+reach::plugins::EvaluationBasePtr ManipulabilityMoveIt::clone() const
+{
+  return boost::make_shared<ManipulabilityMoveIt>(*this);
+}
+
 double ManipulabilityMoveIt::calculateScore(const Eigen::MatrixXd& jacobian_singular_values)
 {
   return jacobian_singular_values.array().prod();
 }
 
+reach::plugins::EvaluationBasePtr ManipulabilityRatio::clone() const
+{
+  return boost::make_shared<ManipulabilityRatio>(*this);
+}
+
 double ManipulabilityRatio::calculateScore(const Eigen::MatrixXd& jacobian_singular_values)
 {
   return jacobian_singular_values.minCoeff() / jacobian_singular_values.maxCoeff();
@@ -189,6 +200,11 @@ bool ManipulabilityScaled::initialize(XmlRpc::XmlRpcValue& config)
   return ret;
 }
 
+reach::plugins::EvaluationBasePtr ManipulabilityScaled::clone() const
+{
+  return boost::make_shared<ManipulabilityScaled>(*this);
+}
+
 double ManipulabilityScaled::calculateScore(const Eigen::MatrixXd& jacobian_singular_values)
 {
   if (std::abs(characteristic_length_) < std::numeric_limits<double>::epsilon())
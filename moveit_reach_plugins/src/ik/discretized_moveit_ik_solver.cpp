@@ -15,9 +15,12 @@
  */
 #include "moveit_reach_plugins/ik/discretized_moveit_ik_solver.h"
 #include <eigen_conversions/eigen_msg.h>
+#include <reach_core/utils/parallel_utils.h>
 #include <ros/console.h>
 #include <xmlrpcpp/XmlRpcException.h>
 #include <algorithm>
+#include <cmath>
+#include <numeric>
 
 namespace
 {
@@ -45,6 +48,7 @@ bool DiscretizedMoveItIKSolver::initialize(XmlRpc::XmlRpcValue& config)
     return false;
   }
 
+  double coarse_dt = M_PI / 4.0;
   try
   {
     dt_ = std::abs(double(config["discretization_angle"]));
@@ -54,6 +58,44 @@ bool DiscretizedMoveItIKSolver::initialize(XmlRpc::XmlRpcValue& config)
       ROS_WARN_STREAM("Clamping discretization angle between 0 and pi; new value is " << clamped_dt);
     }
     dt_ = clamped_dt;
+
+    if (config.hasMember("n_threads"))
+    {
+      n_threads_ = std::max(int(config["n_threads"]), 1);
+    }
+
+    if (config.hasMember("search_mode"))
+    {
+      const std::string mode = std::string(config["search_mode"]);
+      if (mode == "exhaustive")
+      {
+        search_mode_ = SearchMode::EXHAUSTIVE;
+      }
+      else if (mode == "coarse_to_fine")
+      {
+        search_mode_ = SearchMode::COARSE_TO_FINE;
+      }
+      else
+      {
+        ROS_ERROR_STREAM("Unknown search mode '" << mode << "'; expected 'exhaustive' or 'coarse_to_fine'");
+        return false;
+      }
+    }
+
+    if (config.hasMember("continuation"))
+    {
+      continuation_ = bool(config["continuation"]);
+    }
+
+    if (config.hasMember("coarse_discretization_angle"))
+    {
+      coarse_dt = std::abs(double(config["coarse_discretization_angle"]));
+    }
+
+    if (config.hasMember("n_refined_rotations"))
+    {
+      n_refined_rotations_ = std::max(int(config["n_refined_rotations"]), 1);
+    }
   }
   catch (const XmlRpc::XmlRpcException& ex)
   {
@@ -61,6 +103,16 @@ bool DiscretizedMoveItIKSolver::initialize(XmlRpc::XmlRpcValue& config)
     return false;
   }
 
+  // Calculate the number of discretizations necessary to achieve discretization angle
+  n_discretizations_ = dt_ > 0.0 ? std::max(int((2.0 * M_PI) / dt_), 1) : 1;
+  coarse_step_ = dt_ > 0.0 ? clamp<int>(int(std::round(coarse_dt / dt_)), 1, n_discretizations_) : 1;
+
+  if (!createSweepSolvers())
+  {
+    ROS_ERROR("Failed to create the solvers of the discretized targets");
+    return false;
+  }
+
   ROS_INFO_STREAM("Successfully initialized DiscretizedMoveItIKSolver plugin");
   return true;
 }
@@ -69,33 +121,51 @@ boost::optional<double> DiscretizedMoveItIKSolver::solveIKFromSeed(const Eigen::
                                                                    const std::map<std::string, double>& seed,
                                                                    std::vector<double>& solution)
 {
-  // Calculate the number of discretizations necessary to achieve discretization angle
-  const static int n_discretizations = int((2.0 * M_PI) / dt_);
+  // Keep the solutions by index, such that the best solution does not depend on the order in which they are found
+  std::vector<bool> solved(n_discretizations_, false);
+  std::vector<boost::optional<double>> scores(n_discretizations_);
+  std::vector<std::vector<double>> solutions(n_discretizations_);
 
-  // Set up containers for the best solution to be saved into the database
-  std::vector<double> best_solution;
-  double best_score = 0;
-
-  for (int i = 0; i < n_discretizations; ++i)
+  std::vector<int> indices;
+  const int step = search_mode_ == SearchMode::COARSE_TO_FINE ? coarse_step_ : 1;
+  for (int i = 0; i < n_discretizations_; i += step)
   {
-    Eigen::Isometry3d discretized_target(target * Eigen::AngleAxisd(double(i) * dt_, Eigen::Vector3d::UnitZ()));
-    std::vector<double> tmp_solution;
+    indices.push_back(i);
+  }
+  solveDiscretizations(indices, target, std::vector<std::map<std::string, double>>(indices.size(), seed), solved,
+                       scores, solutions);
 
-    boost::optional<double> score = MoveItIKSolver::solveIKFromSeed(discretized_target, seed, tmp_solution);
-    if (score && (score.get() > best_score))
+  if (step > 1)
+  {
+    if (std::none_of(scores.begin(), scores.end(), [](const boost::optional<double>& s) { return bool(s); }))
     {
-      best_score = *score;
-      best_solution = std::move(tmp_solution);
+      // The feasible rotations (if any) lie between the coarse rotations, so fall back to solving all of them
+      indices.resize(n_discretizations_);
+      std::iota(indices.begin(), indices.end(), 0);
+      solveDiscretizations(indices, target, std::vector<std::map<std::string, double>>(indices.size(), seed), solved,
+                           scores, solutions);
     }
     else
     {
-      continue;
+      refineDiscretizations(target, seed, solved, scores, solutions);
+    }
+  }
+
+  // Find the best solution
+  int best = -1;
+  double best_score = 0;
+  for (int i = 0; i < n_discretizations_; ++i)
+  {
+    if (scores[i] && (scores[i].get() > best_score))
+    {
+      best_score = *scores[i];
+      best = i;
     }
   }
 
-  if (best_score > 0)
+  if (best >= 0)
   {
-    solution = std::move(best_solution);
+    solution = std::move(solutions[best]);
     return boost::optional<double>(best_score);
   }
   else
@@ -104,6 +174,180 @@ boost::optional<double> DiscretizedMoveItIKSolver::solveIKFromSeed(const Eigen::
   }
 }
 
+void DiscretizedMoveItIKSolver::refineDiscretizations(const Eigen::Isometry3d& target,
+                                                      const std::map<std::string, double>& seed,
+                                                      std::vector<bool>& solved,
+                                                      std::vector<boost::optional<double>>& scores,
+                                                      std::vector<std::vector<double>>& solutions)
+{
+  // Returns the distance from the input rotation to the closest solved rotation in the input direction, wrapping
+  // around, or n_discretizations_ if the input rotation is the only one solved
+  auto distanceToSolved = [&](const int i, const int direction) {
+    int d = 1;
+    while (d < n_discretizations_ && !solved[(i + direction * d + n_discretizations_) % n_discretizations_])
+    {
+      ++d;
+    }
+    return d;
+  };
+
+  std::vector<int> ranked;
+  std::vector<int> indices;
+  std::vector<std::map<std::string, double>> seeds;
+  while (true)
+  {
+    // Rank the feasible rotations by score, breaking ties by index such that the search is deterministic
+    ranked.clear();
+    for (int i = 0; i < n_discretizations_; ++i)
+    {
+      if (scores[i])
+        ranked.push_back(i);
+    }
+    const std::size_t n_refined = std::min(ranked.size(), static_cast<std::size_t>(n_refined_rotations_));
+    std::partial_sort(ranked.begin(), ranked.begin() + n_refined, ranked.end(), [&](const int lhs, const int rhs) {
+      return *scores[lhs] > *scores[rhs] || (*scores[lhs] == *scores[rhs] && lhs < rhs);
+    });
+
+    // Solve the rotations halfway between each of the best rotations and the closest solved rotations on either side
+    // of it. The intervals between solved rotations need not be equal, e.g. the interval between the last coarse
+    // rotation and the first one, which wraps around, is shorter if the coarse step does not divide the rotations
+    indices.clear();
+    seeds.clear();
+    for (std::size_t r = 0; r < n_refined; ++r)
+    {
+      const int i = ranked[r];
+      for (const int direction : { -1, 1 })
+      {
+        const int distance = distanceToSolved(i, direction);
+        if (distance < 2)
+          continue;
+
+        const int mid = (i + direction * (distance / 2) + n_discretizations_) % n_discretizations_;
+        if (std::find(indices.begin(), indices.end(), mid) != indices.end())
+          continue;
+
+        // In continuation mode, seed the rotation with the solution of the rotation being refined
+        indices.push_back(mid);
+        seeds.push_back(continuation_ ? toSeed(solutions[i]) : seed);
+      }
+    }
+
+    // Stop once the best rotations are surrounded by solved rotations
+    if (indices.empty())
+      break;
+
+    solveDiscretizations(indices, target, seeds, solved, scores, solutions);
+  }
+}
+
+void DiscretizedMoveItIKSolver::solveDiscretizations(const std::vector<int>& indices, const Eigen::Isometry3d& target,
+                                                     const std::vector<std::map<std::string, double>>& seeds,
+                                                     std::vector<bool>& solved,
+                                                     std::vector<boost::optional<double>>& scores,
+                                                     std::vector<std::vector<double>>& solutions)
+{
+  std::vector<int> unsolved;
+  std::vector<const std::map<std::string, double>*> unsolved_seeds;
+  for (std::size_t j = 0; j < indices.size(); ++j)
+  {
+    if (!solved[indices[j]])
+    {
+      solved[indices[j]] = true;
+      unsolved.push_back(indices[j]);
+      unsolved_seeds.push_back(&seeds[j]);
+    }
+  }
+
+  auto solveRotation = [&](const int i, const std::map<std::string, double>& rotation_seed, const std::size_t worker) {
+    Eigen::Isometry3d discretized_target(target * Eigen::AngleAxisd(double(i) * dt_, Eigen::Vector3d::UnitZ()));
+    if (worker == 0)
+      scores[i] = MoveItIKSolver::solveIKFromSeed(discretized_target, rotation_seed, solutions[i]);
+    else
+      scores[i] = sweep_solvers_[worker - 1]->solveIKFromSeed(discretized_target, rotation_seed, solutions[i]);
+  };
+
+  const std::size_t n_workers = sweep_threads_->size();
+  if (!continuation_)
+  {
+    auto solve = [&](const std::size_t j, const std::size_t worker) {
+      solveRotation(unsolved[j], *unsolved_seeds[j], worker);
+    };
+    sweep_threads_->parallelFor(unsolved.size(), 1, solve);
+    return;
+  }
+
+  // In continuation mode, divide the rotations into one contiguous block per worker. The rotations of each block are
+  // solved in order, each seeded with the solution of the previous feasible rotation of the block, which is much closer
+  // to its solution than the input seed
+  const std::size_t n_blocks = std::min(n_workers, unsolved.size());
+  auto solveBlock = [&](const std::size_t b, const std::size_t worker) {
+    const std::size_t begin = (unsolved.size() * b) / n_blocks;
+    const std::size_t end = (unsolved.size() * (b + 1)) / n_blocks;
+    std::map<std::string, double> rotation_seed = *unsolved_seeds[begin];
+    for (std::size_t j = begin; j < end; ++j)
+    {
+      solveRotation(unsolved[j], rotation_seed, worker);
+      if (scores[unsolved[j]])
+        rotation_seed = toSeed(solutions[unsolved[j]]);
+    }
+  };
+  sweep_threads_->parallelFor(n_blocks, 1, solveBlock);
+}
+
+std::map<std::string, double> DiscretizedMoveItIKSolver::toSeed(const std::vector<double>& solution) const
+{
+  const std::vector<std::string> joint_names = getJointNames();
+  std::map<std::string, double> seed;
+  for (std::size_t i = 0; i < solution.size() && i < joint_names.size(); ++i)
+  {
+    seed.emplace(joint_names[i], solution[i]);
+  }
+  return seed;
+}
+
+bool DiscretizedMoveItIKSolver::createSweepSolvers()
+{
+  sweep_solvers_.clear();
+  const int n_solvers = std::min(n_threads_, n_discretizations_) - 1;
+  for (int i = 0; i < n_solvers; ++i)
+  {
+    boost::shared_ptr<MoveItIKSolver> solver(new MoveItIKSolver());
+    if (!copyTo(*solver))
+    {
+      return false;
+    }
+    sweep_solvers_.push_back(solver);
+  }
+
+  // Start the threads of the sweep once, rather than for every solve
+  sweep_threads_ = std::make_shared<reach::utils::ThreadPool>(sweep_solvers_.size() + 1);
+  return true;
+}
+
+reach::plugins::IKSolverBasePtr DiscretizedMoveItIKSolver::clone() const
+{
+  boost::shared_ptr<DiscretizedMoveItIKSolver> copy(new DiscretizedMoveItIKSolver());
+  if (!copyTo(*copy))
+  {
+    return nullptr;
+  }
+  copy->dt_ = dt_;
+  copy->n_discretizations_ = n_discretizations_;
+  // Clones are only created for solvers used concurrently by the workers of the reach study, which already keep all of
+  // the cores busy, so the clones solve their rotations on the calling thread. Otherwise every clone would hold
+  // another n_threads - 1 planning scenes and threads, i.e. pool size x n_threads of each in total
+  copy->n_threads_ = 1;
+  copy->search_mode_ = search_mode_;
+  copy->coarse_step_ = coarse_step_;
+  copy->n_refined_rotations_ = n_refined_rotations_;
+  copy->continuation_ = continuation_;
+  if (!copy->createSweepSolvers())
+  {
+    return nullptr;
+  }
+  return copy;
+}
+
 }  // namespace ik
 }  // namespace moveit_reach_plugins
 
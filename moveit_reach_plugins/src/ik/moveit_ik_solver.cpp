@@ -20,6 +20,7 @@
 #include <moveit_msgs/PlanningScene.h>
 #include <pluginlib/class_loader.h>
 #include <xmlrpcpp/XmlRpcException.h>
+#include <memory>
 
 namespace moveit_reach_plugins
 {
@@ -28,10 +29,15 @@ namespace ik
 const static std::string PACKAGE = "reach_core";
 const static std::string EVAL_PLUGIN_BASE = "reach::plugins::EvaluationBase";
 
-MoveItIKSolver::MoveItIKSolver() : reach::plugins::IKSolverBase(), class_loader_(PACKAGE, EVAL_PLUGIN_BASE)
+MoveItIKSolver::MoveItIKSolver()
+  : reach::plugins::IKSolverBase()
+  , class_loader_(PACKAGE, EVAL_PLUGIN_BASE)
+  , validity_callback_(boost::bind(&MoveItIKSolver::isIKSolutionValid, this, _1, _2, _3))
 {
 }
 
+MoveItIKSolver::~MoveItIKSolver() = default;
+
 bool MoveItIKSolver::initialize(XmlRpc::XmlRpcValue& config)
 {
   if (!config.hasMember("planning_group") || !config.hasMember("distance_threshold") ||
@@ -121,30 +127,47 @@ boost::optional<double> MoveItIKSolver::solveIKFromSeed(const Eigen::Isometry3d&
                                                         const std::map<std::string, double>& seed,
                                                         std::vector<double>& solution)
 {
-  moveit::core::RobotState state(model_);
+  // Reuse the robot state and buffers of this solver rather than allocating them for every solve. The joints outside of
+  // the planning group stay at their default values
+  if (!state_)
+  {
+    state_.reset(new moveit::core::RobotState(model_));
+    state_->setToDefaultValues();
+  }
+  moveit::core::RobotState& state = *state_;
 
   const std::vector<std::string>& joint_names = jmg_->getActiveJointModelNames();
 
-  std::vector<double> seed_subset;
-  if (!utils::transcribeInputMap(seed, joint_names, seed_subset))
+  if (!utils::transcribeInputMap(seed, joint_names, seed_buffer_))
   {
     ROS_ERROR_STREAM(__FUNCTION__ << ": failed to transcribe input pose map");
     return {};
   }
 
-  state.setJointGroupPositions(jmg_, seed_subset);
+  state.setJointGroupPositions(jmg_, seed_buffer_);
   state.update();
 
-  if (state.setFromIK(jmg_, target, 0.0, boost::bind(&MoveItIKSolver::isIKSolutionValid, this, _1, _2, _3)))
+  if (state.setFromIK(jmg_, target, 0.0, validity_callback_))
   {
-    solution.clear();
     state.copyJointGroupPositions(jmg_, solution);
 
-    // Convert back to map
-    std::map<std::string, double> solution_map;
+    // Convert back to map, overwriting the values of the map of the previous solve if it has the same joints
+    std::map<std::string, double>& solution_map = solution_buffer_;
+    if (solution_map.size() != solution.size())
+      solution_map.clear();
+
     for (std::size_t i = 0; i < solution.size(); ++i)
     {
-      solution_map.emplace(joint_names[i], solution[i]);
+      solution_map[joint_names[i]] = solution[i];
+    }
+
+    if (solution_map.size() != solution.size())
+    {
+      solution_map.clear();
+      for (std::size_t i = 0; i < solution.size(); ++i)
+      {
+        solution_map.emplace(joint_names[i], solution[i]);
+      }
     }
 
     return eval_->calculateScore(solution_map);
@@ -161,11 +184,28 @@ bool MoveItIKSolver::isIKSolutionValid(moveit::core::RobotState* state, const mo
   state->setJointGroupPositions(jmg, ik_solution);
   state->update();
 
-  const bool colliding = scene_->isStateColliding(*state, jmg->getName(), false);
-  const bool too_close =
-      (scene_->distanceToCollision(*state, scene_->getAllowedCollisionMatrix()) < distance_threshold_);
+  // Check for collisions first, which stops at the first contact found and only tests the pairs of objects whose
+  // bounding volumes overlap
+  if (scene_->isStateColliding(*state, jmg->getName(), false))
+    return false;
+
+  // A state that is not in collision satisfies a threshold of zero, so the distance query can be skipped
+  if (distance_threshold_ <= 0.0)
+    return true;
+
+  // Otherwise find whether any pair of objects is closer than the threshold. Pairs whose bounding volumes are farther
+  // apart than the threshold are not measured
+  collision_detection::DistanceRequest req;
+  req.type = collision_detection::DistanceRequestType::GLOBAL;
+  req.acm = &scene_->getAllowedCollisionMatrix();
+  req.distance_threshold = distance_threshold_;
+  req.enable_nearest_points = false;
+  req.enable_signed_distance = false;
 
-  return (!colliding && !too_close);
+  collision_detection::DistanceResult res;
+  scene_->getCollisionEnv()->distanceRobot(req, res, *state);
+
+  return res.minimum_distance.distance >= distance_threshold_;
 }
 
 std::vector<std::string> MoveItIKSolver::getJointNames() const
@@ -173,6 +213,36 @@ std::vector<std::string> MoveItIKSolver::getJointNames() const
   return jmg_->getActiveJointModelNames();
 }
 
+reach::plugins::IKSolverBasePtr MoveItIKSolver::clone() const
+{
+  boost::shared_ptr<MoveItIKSolver> copy(new MoveItIKSolver());
+  if (!copyTo(*copy))
+  {
+    return nullptr;
+  }
+  return copy;
+}
+
+bool MoveItIKSolver::copyTo(MoveItIKSolver& other) const
+{
+  other.eval_ = eval_->clone();
+  if (!other.eval_)
+  {
+    ROS_WARN("Evaluation plugin does not support cloning");
+    return false;
+  }
+
+  other.model_ = model_;
+  other.scene_ = planning_scene::PlanningScene::clone(scene_);
+  other.jmg_ = jmg_;
+  other.distance_threshold_ = distance_threshold_;
+  other.collision_mesh_filename_ = collision_mesh_filename_;
+  other.collision_mesh_frame_ = collision_mesh_frame_;
+  other.touch_links_ = touch_links_;
+
+  return true;
+}
+
 }  // namespace ik
 }  // namespace moveit_reach_plugins
 
@@ -170,25 +170,22 @@ bool transcribeInputMap(const std::map<std::string, double>& input, const std::v
     return false;
   }
 
-  // Pull the joints of the planning group out of the input map
-  std::vector<double> tmp;
-  tmp.reserve(joint_names.size());
-  for (const std::string& name : joint_names)
+  // Pull the joints of the planning group out of the input map, reusing the memory of the output vector
+  input_subset.resize(joint_names.size());
+  for (std::size_t i = 0; i < joint_names.size(); ++i)
   {
-    const auto it = input.find(name);
+    const auto it = input.find(joint_names[i]);
     if (it == input.end())
     {
-      ROS_ERROR_STREAM("Joint '" << name << "' in the planning group was not in the input map");
+      ROS_ERROR_STREAM("Joint '" << joint_names[i] << "' in the planning group was not in the input map");
       return false;
     }
     else
     {
-      tmp.push_back(it->second);
+      input_subset[i] = it->second;
     }
   }
 
-  input_subset = std::move(tmp);
-
   return true;
 }
 
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <ros/ros.h>
+#include <pluginlib/class_loader.h>
+#include <reach_core/plugins/ik_solver_base.h>
+#include <moveit/common_planning_interface_objects/common_objects.h>
+#include <moveit/robot_state/robot_state.h>
+#include <xmlrpcpp/XmlRpcException.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+// Number of heap allocations made by the process
+std::atomic<std::size_t> n_allocations{ 0 };
+
+}  // namespace
+
+// Count the heap allocations of the whole process, including those of the IK solver plugin
+void* operator new(std::size_t size)
+{
+  ++n_allocations;
+  if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+/**
+ * @brief Solves IK for random reachable targets with the configured IK solver plugin, and reports the time and the
+ * number of heap allocations per solve once the solver has warmed up
+ */
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "ik_solver_benchmark");
+  ros::NodeHandle pnh("~");
+
+  XmlRpc::XmlRpcValue config;
+  if (!pnh.getParam("ik_solver", config))
+  {
+    ROS_ERROR_STREAM("Failed to get 'ik_solver' parameter");
+    return -1;
+  }
+
+  int n_targets;
+  pnh.param<int>("n_targets", n_targets, 100);
+  n_targets = std::max(n_targets, 1);
+
+  pluginlib::ClassLoader<reach::plugins::IKSolverBase> loader("reach_core", "reach::plugins::IKSolverBase");
+  reach::plugins::IKSolverBasePtr solver;
+  std::string planning_group;
+  try
+  {
+    solver = loader.createInstance(std::string(config["name"]));
+    planning_group = std::string(config["planning_group"]);
+  }
+  catch (const pluginlib::ClassLoaderException& ex)
+  {
+    ROS_ERROR_STREAM(ex.what());
+    return -1;
+  }
+  catch (const XmlRpc::XmlRpcException& ex)
+  {
+    ROS_ERROR_STREAM(ex.getMessage());
+    return -1;
+  }
+
+  if (!solver->initialize(config))
+  {
+    ROS_ERROR("Failed to initialize IK solver plugin");
+    return -1;
+  }
+
+  const moveit::core::RobotModelConstPtr model = moveit::planning_interface::getSharedRobotModel("robot_description");
+  const moveit::core::JointModelGroup* jmg = model ? model->getJointModelGroup(planning_group) : nullptr;
+  if (!jmg)
+  {
+    ROS_ERROR_STREAM("Failed to get joint model group for '" << planning_group << "'");
+    return -1;
+  }
+
+  // Create reachable targets from random joint positions, and seed each solve with the default joint positions
+  moveit::core::RobotState state(model);
+  state.setToDefaultValues();
+
+  std::map<std::string, double> seed;
+  for (const std::string& name : solver->getJointNames())
+  {
+    seed.emplace(name, state.getVariablePosition(name));
+  }
+
+  const moveit::core::LinkModel* tip = jmg->getLinkModels().back();
+  std::vector<Eigen::Isometry3d> targets;
+  for (int i = 0; i < n_targets; ++i)
+  {
+    state.setToRandomPositions(jmg);
+    state.update();
+    targets.push_back(state.getGlobalLinkTransform(tip));
+  }
+
+  std::vector<double> solution;
+  auto solveAll = [&]() {
+    int n_solved = 0;
+    for (const Eigen::Isometry3d& target : targets)
+    {
+      if (solver->solveIKFromSeed(target, seed, solution))
+        ++n_solved;
+    }
+    return n_solved;
+  };
+
+  // Warm up the solver, such that its buffers have grown to size
+  solveAll();
+
+  n_allocations = 0;
+  const auto start = std::chrono::steady_clock::now();
+  const int n_solved = solveAll();
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const std::size_t allocations = n_allocations;
+
+  ROS_INFO_STREAM("Solved " << n_solved << " of " << targets.size() << " targets");
+  ROS_INFO_STREAM("Time per solve: " << 1.0e6 * elapsed / targets.size() << " us");
+  ROS_INFO_STREAM("Heap allocations per solve: " << static_cast<double>(allocations) / targets.size());
+
+  return 0;
+}
@@ -16,12 +16,12 @@
 #ifndef REACH_CORE_IK_HELPER_H
 #define REACH_CORE_IK_HELPER_H
 
+#include <reach_core/neighbor_graph.h>
 #include <reach_core/reach_database.h>
 #include <reach_core/study_parameters.h>
 #include <reach_core/plugins/ik_solver_base.h>
 
 #include <boost/optional.hpp>
-#include <pcl/search/kdtree.h>
 
 namespace reach
 {
@@ -31,17 +31,101 @@ struct NeighborReachResult
 {
   std::vector<std::string> reached_pts;
   double joint_distance = 0;
+
+  // Indices of the records updated in the database
+  std::vector<std::size_t> updated_pts;
+};
+
+/**
+ * @brief The NeighborSolution struct holds an IK solution for a neighboring point that improves on its record in the
+ * database
+ */
+struct NeighborSolution
+{
+  // Index of the record of the neighbor
+  std::size_t index;
+  std::vector<double> seed_position;
+  std::vector<double> goal_position;
+  double score;
 };
 
-using SearchTreePtr = pcl::search::KdTree<pcl::PointXYZ>::Ptr;
+/**
+ * @brief solveNeighbors attempts to reach the neighbors of the input record from its goal state, like
+ * reachNeighborsDirect, but returns the solutions that improve on the neighbors' records instead of updating the
+ * database. The solutions can then be applied with ReachDatabase::updateIfBetter in a deterministic order
+ * @param db
+ * @param index index of the record in the database, such that its neighbors can be looked up in the graph without
+ * searching for its ID
+ * @param rec
+ * @param solver
+ * @param radius
+ * @param graph see reachNeighborsDirect
+ * @param reached_pts optional output IDs of the reached neighbors
+ * @return the improving solutions, in the order in which the neighbors were attempted
+ */
+std::vector<NeighborSolution> solveNeighbors(const ReachDatabase& db, const std::size_t index,
+                                             const reach_msgs::ReachRecord& rec,
+                                             reach::plugins::IKSolverBasePtr solver, const double radius,
+                                             NeighborGraphConstPtr graph = nullptr,
+                                             std::vector<std::string>* reached_pts = nullptr);
 
+/**
+ * @brief reachNeighborsDirect attempts to reach the neighbors of the input record from its goal state, updating the
+ * neighbors in the database whose scores improve
+ * @param db
+ * @param rec
+ * @param solver
+ * @param radius
+ * @param graph precomputed neighbors of the records of the database; if null (or if it does not contain the record),
+ * the neighbors are found with a radius search of the database
+ * @return the IDs of the reached neighbors, and the indices of the neighbors whose records were updated
+ */
 NeighborReachResult reachNeighborsDirect(std::shared_ptr<ReachDatabase> db, const reach_msgs::ReachRecord& rec,
                                          reach::plugins::IKSolverBasePtr solver, const double radius,
-                                         SearchTreePtr search_tree = nullptr);
+                                         NeighborGraphConstPtr graph = nullptr);
+
+/**
+ * @brief reachNeighborsRecursive finds the region of points that can be reached by moving from the input record to
+ * its neighbors, from those neighbors to their neighbors, and so on. Each point is attempted with the IK solution of
+ * the point from which it is reached as the seed. The region is expanded breadth-first without recursion, so the
+ * size of the region is not limited by the stack. The database is not modified
+ * @param db
+ * @param msg
+ * @param solver
+ * @param radius
+ * @param graph precomputed neighbors of the records of the database; if null (or if it does not contain a record),
+ * the neighbors are found with a radius search of the database
+ * @param visited optional scratch space with one flag per database record, all of which must be false. The flags are
+ * cleared again before returning, such that the same scratch space can be reused by successive calls from the same
+ * thread without allocating and clearing a flag for every record each time
+ * @return the IDs of the reached points, starting with the input record, and the total joint distance travelled to
+ * reach them
+ */
+NeighborReachResult reachNeighborsRecursive(std::shared_ptr<ReachDatabase> db, const reach_msgs::ReachRecord& msg,
+                                            reach::plugins::IKSolverBasePtr solver, const double radius,
+                                            NeighborGraphConstPtr graph = nullptr,
+                                            std::vector<bool>* visited = nullptr);
 
-void reachNeighborsRecursive(std::shared_ptr<ReachDatabase> db, const reach_msgs::ReachRecord& msg,
-                             reach::plugins::IKSolverBasePtr solver, const double radius, NeighborReachResult result,
-                             SearchTreePtr search_tree = nullptr);
+/**
+ * @brief Number of members below which colorNeighborhoods tries to merge a group into the other groups. The members of
+ * a group are optimized in parallel, and the workers wait for each other at the end of every group, so small groups
+ * leave most of the workers idle. The number does not depend on the number of workers, such that the groups (and
+ * therefore the optimization results) are the same on every machine
+ */
+const std::size_t MIN_COLOR_GROUP_SIZE = 64;
+
+/**
+ * @brief colorNeighborhoods partitions the records of the neighbor graph into groups whose members have no neighbors in
+ * common and are not neighbors of each other. The neighborhoods of the members of a group do not overlap, so
+ * solveNeighbors can be called concurrently for all members of a group without two calls ever modifying the same
+ * record. The records are first colored greedily, which leaves a long tail of small groups; the members of groups
+ * smaller than the input size are then moved to the largest group in which they have no conflicts, where possible
+ * @param graph neighbor graph of the database
+ * @param min_group_size number of members below which a group is merged into the other groups
+ * @return a list of groups, each containing the database indices of its members in increasing order
+ */
+std::vector<std::vector<std::size_t>> colorNeighborhoods(const NeighborGraph& graph,
+                                                         const std::size_t min_group_size = MIN_COLOR_GROUP_SIZE);
 
 }  // namespace core
 }  // namespace reach
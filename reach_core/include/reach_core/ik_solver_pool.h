@@ -0,0 +1,75 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef REACH_CORE_IK_SOLVER_POOL_H
+#define REACH_CORE_IK_SOLVER_POOL_H
+
+#include <reach_core/plugins/ik_solver_base.h>
+
+#include <functional>
+#include <memory>
+
+namespace reach
+{
+namespace core
+{
+/**
+ * @brief The IKSolverPool class provides each worker thread of the reach study with its own IK solver instance, such
+ * that IK solutions can be computed concurrently without sharing any solver state (e.g. planning scenes, evaluation
+ * plugins) between threads. Solvers and evaluation plugins are not required to be thread-safe; their clone() must
+ * instead return a copy that can be used concurrently with the original. A clone may rely on resources owned by the
+ * original (e.g. loaded plugin libraries), so the original must outlive it
+ */
+class IKSolverPool
+{
+public:
+  using Factory = std::function<reach::plugins::IKSolverBasePtr()>;
+
+  /**
+   * @brief IKSolverPool creates a solver for each worker by cloning the prototype solver. If the prototype does not
+   * support cloning, the factory is used to create and initialize a new solver instead. If neither succeeds, the pool
+   * is left empty rather than sharing a solver between workers, since solvers are not required to be thread-safe. A
+   * pool of a single worker uses the prototype itself
+   * @param prototype
+   * @param size
+   * @param factory
+   */
+  IKSolverPool(reach::plugins::IKSolverBasePtr prototype, const std::size_t size, const Factory& factory = Factory());
+
+  /**
+   * @brief get returns the solver owned by the input worker
+   * @param worker
+   * @return
+   */
+  const reach::plugins::IKSolverBasePtr& get(const std::size_t worker) const;
+
+  /**
+   * @brief size returns the number of workers in the pool
+   * @return the number of workers, or 0 if a solver could not be created for every worker
+   */
+  std::size_t size() const;
+
+private:
+  // The prototype must outlive its clones, so it is declared first such that it is destroyed last
+  reach::plugins::IKSolverBasePtr prototype_;
+
+  std::vector<reach::plugins::IKSolverBasePtr> solvers_;
+};
+typedef std::shared_ptr<IKSolverPool> IKSolverPoolPtr;
+
+}  // namespace core
+}  // namespace reach
+
+#endif  // REACH_CORE_IK_SOLVER_POOL_H
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef REACH_CORE_NEIGHBOR_GRAPH_H
+#define REACH_CORE_NEIGHBOR_GRAPH_H
+
+#include <reach_core/reach_database.h>
+#include <reach_core/utils/parallel_utils.h>
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace reach
+{
+namespace core
+{
+/**
+ * @brief The NeighborGraph class stores, for every record of a reach database, the indices of the records whose goal
+ * positions lie within a fixed radius of its own goal position (and, optionally, whose goal z-axes lie within a fixed
+ * angle of its own goal z-axis). The graph is stored in compressed sparse row format:
+ * the neighbors of all records are concatenated into a single array, and the neighbors of record i are the entries
+ * between offsets[i] and offsets[i + 1]. A record is not its own neighbor, and records that are not present in the
+ * database have no neighbors
+ */
+class NeighborGraph
+{
+public:
+  /**
+   * @brief Range of the indices of the neighbors of a record
+   */
+  struct Range
+  {
+    const uint32_t* first;
+    const uint32_t* last;
+
+    const uint32_t* begin() const
+    {
+      return first;
+    }
+
+    const uint32_t* end() const
+    {
+      return last;
+    }
+
+    std::size_t size() const
+    {
+      return static_cast<std::size_t>(last - first);
+    }
+
+    bool empty() const
+    {
+      return first == last;
+    }
+  };
+
+  NeighborGraph() = default;
+
+  /**
+   * @brief build finds the neighbors of all of the records of the database, replacing the current graph. The radius
+   * searches are distributed over multiple threads
+   * @param db
+   * @param radius
+   * @param max_angle maximum angle (radians) between the goal z-axes of neighbors; angles of pi or more disable the
+   * orientation check, such that neighbors are found by position only
+   * @param pool threads over which to distribute the searches
+   */
+  void build(const ReachDatabase& db, const double radius, const double max_angle, utils::ThreadPool& pool);
+
+  /**
+   * @brief save writes the graph to a file at the input location. The file also identifies the goal poses of the
+   * records from which the graph was built, such that a graph is only loaded for the same database
+   * @param filename
+   * @return true on success, false on failure
+   */
+  bool save(const std::string& filename) const;
+
+  /**
+   * @brief load reads a graph saved to the file at the input location, if it was built with the input radius and
+   * angle from the records of the input database (i.e. the records have the same goal poses)
+   * @param filename
+   * @param db
+   * @param radius
+   * @param max_angle
+   * @return true on success, false if the file could not be read or the graph does not match the database, radius and
+   * angle
+   */
+  bool load(const std::string& filename, const ReachDatabase& db, const double radius, const double max_angle);
+
+  /**
+   * @brief neighbors returns the indices of the neighbors of the record at the input index
+   * @param index
+   * @return
+   */
+  Range neighbors(const std::size_t index) const
+  {
+    return Range{ neighbors_.data() + offsets_[index], neighbors_.data() + offsets_[index + 1] };
+  }
+
+  /**
+   * @brief size returns the number of records in the graph
+   * @return
+   */
+  std::size_t size() const
+  {
+    return offsets_.empty() ? 0 : offsets_.size() - 1;
+  }
+
+  /**
+   * @brief numEdges returns the total number of neighbors of all of the records in the graph
+   * @return
+   */
+  std::size_t numEdges() const
+  {
+    return neighbors_.size();
+  }
+
+  double radius() const
+  {
+    return radius_;
+  }
+
+  double maxAngle() const
+  {
+    return max_angle_;
+  }
+
+private:
+  double radius_ = 0.0;
+  double max_angle_ = M_PI;
+
+  // Checksum of the goal poses of the records from which the graph was built
+  uint32_t poses_checksum_ = 0;
+
+  std::vector<uint64_t> offsets_;
+  std::vector<uint32_t> neighbors_;
+};
+typedef std::shared_ptr<NeighborGraph> NeighborGraphPtr;
+typedef std::shared_ptr<const NeighborGraph> NeighborGraphConstPtr;
+
+}  // namespace core
+}  // namespace reach
+
+#endif  // REACH_CORE_NEIGHBOR_GRAPH_H
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef REACH_CORE_OPTIMIZATION_H
+#define REACH_CORE_OPTIMIZATION_H
+
+#include <reach_core/ik_solver_pool.h>
+#include <reach_core/neighbor_graph.h>
+#include <reach_core/reach_database.h>
+#include <reach_core/study_parameters.h>
+#include <reach_core/utils/parallel_utils.h>
+
+#include <vector>
+
+namespace reach
+{
+namespace core
+{
+/**
+ * @brief Summary of a run of the optimization of a reach study database
+ */
+struct OptimizationResult
+{
+  // Number of optimization loops performed
+  int n_loops = 0;
+
+  // True if the optimization stopped because no point was left to optimize
+  bool converged = false;
+};
+
+/**
+ * @brief optimizeReachDatabase improves the IK solutions of the database by solving each neighbor of each reached point
+ * from the IK solution of that point, and keeping the solutions that improve on the neighbors' records. The groups are
+ * visited in a random order (drawn from the seed of the parameters) in every loop, and the members of a group are
+ * solved in parallel against the database as it was at the start of the group. The solutions are then applied in the
+ * order of the members, so the optimized database depends only on the input database, groups and parameters, and not
+ * on the number of workers or their timing. Only the points whose solutions changed are optimized again in the next
+ * loop. The loops stop when no point is left to optimize, when the relative improvement of the normalized total score
+ * falls below the threshold of the parameters, or after the maximum number of steps
+ * @param db
+ * @param groups groups of database indices with non-overlapping neighborhoods (see colorNeighborhoods)
+ * @param graph optional precomputed neighbors of the records of the database (see solveNeighbors)
+ * @param solvers IK solvers of the workers
+ * @param pool threads of the workers, of which there must be no more than solvers
+ * @param params
+ * @param grain_size number of points processed by a worker before it checks for more work
+ * @return
+ */
+OptimizationResult optimizeReachDatabase(ReachDatabase& db, const std::vector<std::vector<std::size_t>>& groups,
+                                         NeighborGraphConstPtr graph, const IKSolverPool& solvers,
+                                         utils::ThreadPool& pool, const StudyOptimization& params,
+                                         const std::size_t grain_size);
+
+}  // namespace core
+}  // namespace reach
+
+#endif  // REACH_CORE_OPTIMIZATION_H
@@ -50,6 +50,15 @@ public:
    * @return
    */
   virtual double calculateScore(const std::map<std::string, double>& pose) = 0;
+
+  /**
+   * @brief clone
+   * @return an initialized copy of this plugin, or a null pointer if cloning is not supported
+   */
+  virtual boost::shared_ptr<EvaluationBase> clone() const
+  {
+    return nullptr;
+  }
 };
 typedef boost::shared_ptr<EvaluationBase> EvaluationBasePtr;
 
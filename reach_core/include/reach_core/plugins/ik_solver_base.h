@@ -17,6 +17,7 @@
 #define REACH_CORE_PLUGINS_IK_IK_SOLVER_BASE_H
 
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 #include <vector>
 #include <xmlrpcpp/XmlRpcValue.h>
 #include <Eigen/Dense>
@@ -63,6 +64,15 @@ public:
    * @return
    */
   virtual std::vector<std::string> getJointNames() const = 0;
+
+  /**
+   * @brief clone
+   * @return an initialized copy of this solver, or a null pointer if cloning is not supported
+   */
+  virtual boost::shared_ptr<IKSolverBase> clone() const
+  {
+    return nullptr;
+  }
 };
 typedef boost::shared_ptr<IKSolverBase> IKSolverBasePtr;
 
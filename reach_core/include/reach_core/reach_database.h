@@ -16,11 +16,17 @@
 #ifndef REACH_CORE_REACH_DATABASE_H
 #define REACH_CORE_REACH_DATABASE_H
 
+#include "reach_core/spatial_index.h"
 #include "reach_core/study_parameters.h"
 #include <reach_msgs/ReachDatabase.h>
 #include <boost/optional.hpp>
+#include <array>
+#include <atomic>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace reach
 {
@@ -58,10 +64,17 @@ std::map<std::string, double> jointStateMsgToMap(const sensor_msgs::JointState&
  * the robot's work area from a given pose, assuming the poses on the reach object are evenly distributed)
  *  - avg_joint_distance: average joint distance required to travel to all of any given pose's reachable neighbors
  * (indicative of the robot's ease of movement or "efficiency" moving from one pose to a neighboring pose
+ *
+ * Records are stored contiguously and addressed by index. Records created by the reach study are identified by the
+ * index of their target in the reach object point cloud (i.e. the ID of the record at index i is "i"), such that record
+ * indices line up with the point cloud. Records with other IDs are appended to the end of the database
+ *
+ * Records can be read and modified concurrently. Operations on existing records only lock the record being accessed,
+ * while operations that add records to the database or access all of its records lock the entire database
  */
 class ReachDatabase
 {
-  using iterator = std::unordered_map<std::string, reach_msgs::ReachRecord>::iterator;
+  using iterator = std::vector<reach_msgs::ReachRecord>::iterator;
 
 public:
   /**
@@ -70,18 +83,49 @@ public:
   ReachDatabase() = default;
 
   /**
-   * @brief save saves the reach study database to a file at the input location
+   * @brief save saves the reach study database to a file at the input location. The database is saved in the columnar
+   * format (see MappedReachDatabase) unless its records do not share the same joints, in which case the ROS serialized
+   * format is used. The database is written to a temporary file which then replaces the file at the input location,
+   * such that a crash while saving leaves the previous file intact. Throws std::runtime_error if the file cannot be
+   * written
    * @param filename
+   * @param compact save the columnar format with the compact (lossy) encoding (see writeColumnarDatabaseFile)
    */
-  void save(const std::string& filename) const;
+  void save(const std::string& filename, const bool compact = false) const;
 
   /**
-   * @brief load loads a saved reach study database from the input location
+   * @brief load loads a saved reach study database from the input location. Both the columnar and the ROS serialized
+   * formats are supported. All records are copied into the database; use MappedReachDatabase to read the records of a
+   * columnar file lazily
    * @param filename
    * @return true on success, false on failure
    */
   bool load(const std::string& filename);
 
+  /**
+   * @brief checkpoint appends the records that have been added to or changed in the database since the previous
+   * checkpoint to a checkpoint file at the input location. A new checkpoint file starts with a header identifying the
+   * study to which it belongs
+   * @param filename
+   * @param n_points number of points of the study
+   * @param study_checksum checksum of the inputs of the study (e.g. its points and IK solver configuration)
+   * @return true on success, false on failure
+   */
+  bool checkpoint(const std::string& filename, const uint64_t n_points, const uint32_t study_checksum);
+
+  /**
+   * @brief loadCheckpoint adds the records saved in a checkpoint file at the input location to the database. A
+   * checkpoint written for a different study (a different number of points or checksum), or without a header, is
+   * stale: it is deleted with a warning, such that the study starts over rather than resuming from unrelated records.
+   * A partial record at the end of the file (from a crash during a checkpoint) is ignored and removed from the file,
+   * such that later checkpoints append after the last complete record
+   * @param filename
+   * @param n_points number of points of the study
+   * @param study_checksum checksum of the inputs of the study
+   * @return true if the checkpoint was loaded, false if it does not exist or was discarded
+   */
+  bool loadCheckpoint(const std::string& filename, const uint64_t n_points, const uint32_t study_checksum);
+
   /**
    * @brief get returns a ReachRecord message from the database
    * @param id
@@ -90,21 +134,82 @@ public:
   boost::optional<reach_msgs::ReachRecord> get(const std::string& id) const;
 
   /**
-   * @brief put adds a ReachRecord message to the database
+   * @brief get returns the ReachRecord message at the input index of the database
+   * @param index
+   * @return
+   */
+  boost::optional<reach_msgs::ReachRecord> get(const std::size_t index) const;
+
+  /**
+   * @brief indexOf returns the index of the record with the input ID
+   * @param id
+   * @return
+   */
+  boost::optional<std::size_t> indexOf(const std::string& id) const;
+
+  /**
+   * @brief put adds a ReachRecord message to the database, replacing the existing record with the same ID
    * @param record
    */
   void put(const reach_msgs::ReachRecord& record);
 
   /**
-   * @brief count counts the number of entries in the database
-   * @return
+   * @brief updateIfBetter atomically marks the record at the input index as reached with the input solution if the
+   * record has not been reached yet or if the input score is better than the score of the record
+   * @param index
+   * @param seed_position joint positions from which the solution was found
+   * @param goal_position joint positions of the solution
+   * @param score score of the solution
+   * @return true if the record was updated, false otherwise
    */
-  std::size_t size() const;
+  bool updateIfBetter(const std::size_t index, const std::vector<double>& seed_position,
+                      const std::vector<double>& goal_position, const double score);
+
+  /**
+   * @brief radiusSearch finds the records whose goal positions lie within the input radius of the input position.
+   * The records are found with a spatial index of their goal positions, which is built on the first query and rebuilt
+   * on the first query after records are added or their goal positions change
+   * @param position
+   * @param radius
+   * @return indices of the records found
+   */
+  std::vector<std::size_t> radiusSearch(const geometry_msgs::Point& position, const double radius) const;
 
   /**
-   * @brief calculateResults calculates the results of the reach study and saves them to internal class members
+   * @brief radiusSearch finds the records whose goal positions lie within the input radius of the position of the
+   * input pose, and whose goal z-axes lie within the input angle of the z-axis of the input pose. Records on opposite
+   * sides of a thin part, whose z-axes point in opposite directions, are thereby excluded. The records are found with
+   * a spatial index that partitions the records by the direction of their z-axes (see OrientedSpatialIndex), which is
+   * built on the first query and rebuilt on the first query after records are added or their goal poses change
+   * @param pose
+   * @param radius
+   * @param max_angle maximum angle (radians) between the z-axes of the input pose and of the goal of a record
+   * @return indices of the records found
    */
-  void calculateResults();
+  std::vector<std::size_t> radiusSearch(const geometry_msgs::Pose& pose, const double radius,
+                                        const double max_angle) const;
+
+  /**
+   * @brief nearestKSearch finds the k records whose goal positions are closest to the input position
+   * @param position
+   * @param k
+   * @return indices of the records found, sorted by increasing distance
+   */
+  std::vector<std::size_t> nearestKSearch(const geometry_msgs::Point& position, const std::size_t k) const;
+
+  /**
+   * @brief setSpatialIndexFactory sets the factory that creates the spatial indices of the goal positions of the
+   * records. The indices are rebuilt with the new factory on the next query
+   * @param factory
+   */
+  void setSpatialIndexFactory(const SpatialIndexFactory& factory);
+
+  /**
+   * @brief size returns the number of record indices in the database. Indices of records that have not yet been added
+   * (e.g. while the reach study is in progress) are included in the count, but do not contain a record
+   * @return
+   */
+  std::size_t size() const;
 
   /**
    * @brief printResults prints the calculated results of the reach study to the terminal
@@ -112,13 +217,12 @@ public:
   void printResults();
 
   /**
-   * @brief getStudyResults
+   * @brief getStudyResults returns the results of the reach study. The reach percentage and scores are maintained as
+   * records are added or changed, so the results are always up to date and cheap to compute. The scores are summed in
+   * fixed point, such that the results do not depend on the order in which the records were changed
    * @return
    */
-  StudyResults getStudyResults() const
-  {
-    return results_;
-  }
+  StudyResults getStudyResults() const;
 
   /**
    * @brief setAverageNeighborsCount
@@ -141,23 +245,95 @@ public:
   // For loops
   iterator begin()
   {
-    return map_.begin();
+    return records_.begin();
   }
 
   iterator end()
   {
-    return map_.end();
+    return records_.end();
   }
 
   reach_msgs::ReachDatabase toReachDatabaseMsg();
 
 private:
+  /**
+   * @brief Lock guarding a subset of the records of the database
+   */
+  struct Stripe
+  {
+    std::mutex mutex;
+
+    // Indices of the records of this stripe changed since the last checkpoint
+    std::unordered_set<std::size_t> dirty;
+
+    // Aggregate statistics of the records of this stripe; the total score of the reached records is in fixed point
+    std::size_t n_records = 0;
+    std::size_t n_reached = 0;
+    int64_t total_score = 0;
+
+    void add(const reach_msgs::ReachRecord& record);
+    void remove(const reach_msgs::ReachRecord& record);
+  };
+
+  /**
+   * @brief findIndex returns the index at which the record with the input ID is or would be stored, if that index
+   * exists. The caller must lock the database and check the ID of the record at the returned index
+   */
+  boost::optional<std::size_t> findIndex(const std::string& id) const;
+
   void putHelper(const reach_msgs::ReachRecord& record);
 
-  std::unordered_map<std::string, reach_msgs::ReachRecord> map_;
+  StudyResults getStudyResultsHelper() const;
+
+  /**
+   * @brief getSpatialIndex returns the spatial index of the goal positions of the records, building it if necessary.
+   * The caller must hold a shared lock on the database, which may be released and reacquired to build the index
+   */
+  SpatialIndexPtr getSpatialIndex(std::shared_lock<std::shared_timed_mutex>& lock) const;
+
+  /**
+   * @brief getOrientedIndex returns the spatial index of the goal positions and z-axes of the records, building it if
+   * necessary, in the same way as getSpatialIndex
+   */
+  OrientedSpatialIndexPtr getOrientedIndex(std::shared_lock<std::shared_timed_mutex>& lock) const;
+
+  Stripe& stripe(const std::size_t index) const
+  {
+    return stripes_[index % stripes_.size()];
+  }
+
+  std::vector<reach_msgs::ReachRecord> records_;
+
+  // Lookup of record index by record ID, for records that are not stored at the index encoded in their ID
+  std::unordered_map<std::string, std::size_t> ids_;
+
+  // Guards the layout of the database. Held shared to access existing records, and exclusively to add records or to
+  // access all records at once
+  mutable std::shared_timed_mutex mutex_;
+
+  // Guard the contents of the records; record i belongs to stripe i % stripes_.size()
+  mutable std::array<Stripe, 64> stripes_;
+
+  std::mutex checkpoint_mutex_;
+
+  // Creates the spatial indices. Guarded by mutex_
+  SpatialIndexFactory spatial_index_factory_ = makeSpatialIndex;
+
+  // Spatial index of the goal positions of the records, and the record index of each of the indexed points. Guarded
+  // by mutex_
+  mutable SpatialIndexPtr spatial_index_;
+  mutable std::vector<std::size_t> spatial_index_records_;
+
+  // Spatial index of the goal positions and z-axes of the records, and the record index of each of the indexed
+  // points. Guarded by mutex_
+  mutable OrientedSpatialIndexPtr oriented_index_;
+  mutable std::vector<std::size_t> oriented_index_records_;
 
-  mutable std::mutex mutex_;
+  // Set when records are added or moved, which may happen under a shared lock
+  mutable std::atomic<bool> spatial_index_stale_{ true };
+  mutable std::atomic<bool> oriented_index_stale_{ true };
 
+  // Results that are not derived from the records themselves (i.e. the neighbor statistics)
   StudyResults results_;
 };
 typedef std::shared_ptr<ReachDatabase> ReachDatabasePtr;
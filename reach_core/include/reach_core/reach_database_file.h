@@ -0,0 +1,220 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef REACH_CORE_REACH_DATABASE_FILE_H
+#define REACH_CORE_REACH_DATABASE_FILE_H
+
+#include <reach_core/study_parameters.h>
+#include <reach_core/utils/mapped_file.h>
+#include <reach_msgs/ReachRecord.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace reach
+{
+namespace core
+{
+/**
+ * @brief isColumnarDatabaseFile checks whether the file at the input location is a columnar reach database file
+ * @param filename
+ * @return
+ */
+bool isColumnarDatabaseFile(const std::string& filename);
+
+/**
+ * @brief haveCommonJoints checks whether all of the records (other than those with an empty ID) contain seed and goal
+ * states with the same joints, as required to write them to a columnar reach database file
+ * @param records
+ * @return
+ */
+bool haveCommonJoints(const std::vector<reach_msgs::ReachRecord>& records);
+
+/**
+ * @brief writeColumnarDatabaseFile writes reach records to a columnar reach database file. Each field of the records
+ * (positions, orientations, reached flags, scores, seed and goal joint positions, IDs) is stored as a separate aligned
+ * column such that the file can be memory mapped and queried without deserializing it. The joint names are stored only
+ * once, so all records must contain seed and goal states with the same joints (see haveCommonJoints). Records with an
+ * empty ID are stored as empty entries. The columns are written directly from the input records in fixed-size chunks,
+ * each protected by a CRC-32 checksum, so writing takes a constant amount of extra memory regardless of the number of
+ * records.
+ *
+ * The compact encoding reduces the size of the file by storing:
+ *  - goal positions and orientations in single precision
+ *  - scores as 32-bit mantissas sharing an exponent per block of 64 records
+ *  - seed joint positions quantized to 1e-6 and variable-length encoded
+ *  - goal joint positions as quantized, variable-length encoded differences from the seed joint positions
+ * @param filename
+ * @param records
+ * @param results
+ * @param compact use the compact (lossy) encoding
+ * @return false if the records do not share the same joints or the file could not be written
+ */
+bool writeColumnarDatabaseFile(const std::string& filename, const std::vector<reach_msgs::ReachRecord>& records,
+                               const StudyResults& results, const bool compact = false);
+
+/**
+ * @brief The MappedReachDatabase class provides read-only access to a columnar reach database file by memory mapping
+ * it. Records are only read from the file when they are accessed, so opening a file takes constant time and memory
+ * regardless of its size. The joint positions of compact files are decoded a block of records at a time and cached,
+ * so an instance must not be accessed concurrently from multiple threads
+ */
+class MappedReachDatabase
+{
+public:
+  MappedReachDatabase() = default;
+
+  MappedReachDatabase(const MappedReachDatabase&) = delete;
+  MappedReachDatabase& operator=(const MappedReachDatabase&) = delete;
+
+  /**
+   * @brief open memory maps the columnar reach database file at the input location
+   * @param filename
+   * @return true on success, false if the file could not be mapped or is not a valid columnar reach database file
+   */
+  bool open(const std::string& filename);
+
+  /**
+   * @brief close unmaps the file
+   */
+  void close();
+
+  bool isOpen() const
+  {
+    return file_.isOpen();
+  }
+
+  /**
+   * @brief verify checks the contents of the file against the checksums stored in the file, and checks that the
+   * offsets of the record IDs and of the blocks of compact joint positions are consistent, such that every record can
+   * be read. Files written before checksums were introduced (version 1) are only checked for consistency. The checks
+   * read the entire file, so they are not part of open
+   * @return true if all checksums match and the offsets are consistent, false otherwise
+   */
+  bool verify() const;
+
+  /**
+   * @brief isCompact checks whether the file uses the compact encoding
+   * @return
+   */
+  bool isCompact() const
+  {
+    return compact_;
+  }
+
+  /**
+   * @brief size returns the number of entries in the file, including entries that do not contain a record
+   * @return
+   */
+  std::size_t size() const
+  {
+    return n_records_;
+  }
+
+  const StudyResults& getStudyResults() const
+  {
+    return results_;
+  }
+
+  const std::vector<std::string>& getJointNames() const
+  {
+    return joint_names_;
+  }
+
+  /**
+   * @brief contains checks whether the entry at the input index contains a record
+   * @param index
+   * @return
+   */
+  bool contains(const std::size_t index) const
+  {
+    return (present_[index / 64] >> (index % 64)) & 1u;
+  }
+
+  bool reached(const std::size_t index) const
+  {
+    return (reached_[index / 64] >> (index % 64)) & 1u;
+  }
+
+  double score(const std::size_t index) const;
+
+  geometry_msgs::Pose goal(const std::size_t index) const;
+
+  /**
+   * @brief seedPosition returns the seed joint positions of the record at the input index, in the order of the joint
+   * names
+   */
+  std::vector<double> seedPosition(const std::size_t index) const;
+
+  /**
+   * @brief goalPosition returns the goal joint positions of the record at the input index, in the order of the joint
+   * names
+   */
+  std::vector<double> goalPosition(const std::size_t index) const;
+
+  std::string id(const std::size_t index) const;
+
+  /**
+   * @brief record reconstructs the full ReachRecord message at the input index
+   * @param index
+   * @return
+   */
+  reach_msgs::ReachRecord record(const std::size_t index) const;
+
+private:
+  /**
+   * @brief decodeJointBlock decodes the joint positions of the block of records containing the input index of a
+   * compact file into the joint position cache
+   */
+  void decodeJointBlock(const std::size_t index) const;
+
+  utils::MappedFile file_;
+
+  // Offset and size (in bytes) of each column of the file that is protected by checksums
+  std::vector<std::pair<std::size_t, std::size_t>> columns_;
+  std::size_t chunk_size_ = 0;
+  const uint32_t* checksums_ = nullptr;
+
+  bool compact_ = false;
+  std::size_t n_records_ = 0;
+  std::size_t n_joints_ = 0;
+  StudyResults results_;
+  std::vector<std::string> joint_names_;
+
+  const uint64_t* present_ = nullptr;
+  const uint64_t* reached_ = nullptr;
+  const char* positions_ = nullptr;
+  const char* orientations_ = nullptr;
+  const char* scores_ = nullptr;
+  const char* seed_positions_ = nullptr;
+  std::size_t seed_positions_size_ = 0;
+  const char* goal_positions_ = nullptr;
+  std::size_t goal_positions_size_ = 0;
+  const uint64_t* id_offsets_ = nullptr;
+  const char* id_chars_ = nullptr;
+  std::size_t id_chars_size_ = 0;
+
+  // Joint positions of the most recently decoded block of records of a compact file
+  mutable std::size_t cached_block_ = SIZE_MAX;
+  mutable std::vector<double> cached_seed_positions_;
+  mutable std::vector<double> cached_goal_positions_;
+};
+
+}  // namespace core
+}  // namespace reach
+
+#endif  // REACH_CORE_REACH_DATABASE_FILE_H
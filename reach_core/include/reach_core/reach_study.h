@@ -18,7 +18,9 @@
 
 #include <reach_core/study_parameters.h>
 #include <reach_core/ik_helper.h>
+#include <reach_core/ik_solver_pool.h>
 #include <reach_core/reach_visualizer.h>
+#include <reach_core/utils/parallel_utils.h>
 #include <reach_core/plugins/ik_solver_base.h>
 #include <pcl_ros/point_cloud.h>
 #include <pluginlib/class_loader.h>
@@ -54,10 +56,23 @@ private:
 
   void runInitialReachStudy();
 
+  /**
+   * @brief studyChecksum returns a checksum of the inputs that determine the results of the initial reach study: the
+   * points and normals of the reach object point cloud, the frames and the IK solver configuration. It identifies the
+   * study to which a checkpoint belongs
+   */
+  uint32_t studyChecksum() const;
+
   void optimizeReachStudyResults();
 
   void getAverageNeighborsCount();
 
+  /**
+   * @brief getNeighborGraph returns the neighbor graph of the database records for the optimization radius, loading or
+   * building it on the first call. The goal positions of the records must not change after the first call
+   */
+  NeighborGraphConstPtr getNeighborGraph();
+
   bool compareDatabases();
 
   ros::NodeHandle nh_;
@@ -73,10 +88,14 @@ private:
   pluginlib::ClassLoader<reach::plugins::DisplayBase> display_loader_;
   reach::plugins::IKSolverBasePtr ik_solver_;
   reach::plugins::DisplayBasePtr display_;
+  IKSolverPoolPtr solver_pool_;
+
+  // Worker threads of the parallel phases of the study, one per solver of the pool
+  utils::ThreadPoolPtr thread_pool_;
 
   ReachVisualizerPtr visualizer_;
 
-  SearchTreePtr search_tree_;
+  NeighborGraphConstPtr neighbor_graph_;
 
   std::string dir_;
 
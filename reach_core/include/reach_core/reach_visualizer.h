@@ -21,6 +21,8 @@
 #include <reach_core/plugins/ik_solver_base.h>
 #include <reach_core/ik_helper.h>
 
+#include <memory>
+
 namespace reach
 {
 namespace core
@@ -38,13 +40,23 @@ public:
    * @param solver
    * @param display
    * @param neighbor_radius
-   * @param search_tree
    */
   ReachVisualizer(ReachDatabasePtr db, reach::plugins::IKSolverBasePtr solver, reach::plugins::DisplayBasePtr display,
-                  const double neighbor_radius, SearchTreePtr search_tree = nullptr);
+                  const double neighbor_radius);
 
   void update();
 
+  /**
+   * @brief setNeighborGraph sets the precomputed neighbors of the database records used to find the neighbors of a
+   * record, instead of searching the database
+   * @param graph
+   */
+  void setNeighborGraph(NeighborGraphConstPtr graph)
+  {
+    // The interactive marker callbacks may be running
+    std::atomic_store(&graph_, graph);
+  }
+
 private:
   void reSolveIKCB(const visualization_msgs::InteractiveMarkerFeedbackConstPtr& fb);
 
@@ -62,7 +74,7 @@ private:
 
   reach::plugins::DisplayBasePtr display_;
 
-  SearchTreePtr search_tree_;
+  NeighborGraphConstPtr graph_;
 
   double neighbor_radius_;
 };
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef REACH_CORE_REGION_ANALYSIS_H
+#define REACH_CORE_REGION_ANALYSIS_H
+
+#include <reach_core/ik_solver_pool.h>
+#include <reach_core/neighbor_graph.h>
+#include <reach_core/reach_database.h>
+
+#include <vector>
+
+namespace reach
+{
+namespace core
+{
+/**
+ * @brief Results of the analysis of the regions of the reach object over which the robot can move from point to
+ * neighboring point
+ */
+struct RegionAnalysisResult
+{
+  // Number of points in each region, sorted in decreasing order
+  std::vector<std::size_t> region_sizes;
+
+  // Index of the region of each database record (into region_sizes), or -1 for records that are not in any region
+  std::vector<int> regions;
+
+  // Average number of other points in the region of each database record
+  double avg_num_neighbors = 0.0;
+
+  // Average joint distance of the successful moves between neighboring points. Unlike the recursive neighbor search
+  // that this analysis replaces, which averaged the distance over the points reached by a search from every point,
+  // every move is counted once
+  double avg_joint_distance = 0.0;
+
+  // Number of IK solutions attempted and found for moves between neighboring points
+  std::size_t n_attempts = 0;
+  std::size_t n_moves = 0;
+};
+
+/**
+ * @brief analyzeRegions partitions the reachable points of the database into regions, such that the robot can move
+ * between any two points of a region by moving from point to neighboring point. The regions are expanded in rounds:
+ * the first round attempts the moves out of the points reached by the study, seeded with the IK solutions stored in the
+ * database, and each later round attempts the moves out of the points that the study did not reach but that were moved
+ * to in the round before, seeded with the solution with which they were reached. The move across an edge between two
+ * reached points is attempted only once, from the lower index. A point that the study did not reach joins a single
+ * region: that of the lowest index from which it was reached in the first round in which it was reached at all, since
+ * the robot can only continue from it with that solution. The regions of the endpoints of every other successful
+ * move are merged with a concurrent union-find. The moves out of the points of a round are distributed over the
+ * workers of the solver pool, and the results do not depend on the number of workers. The database is not modified
+ * @param db
+ * @param graph
+ * @param solvers IK solvers of the workers
+ * @param pool threads of the workers, of which there must be no more than solvers
+ * @param grain_size number of points processed by a worker before it checks for more work
+ * @return
+ */
+RegionAnalysisResult analyzeRegions(const ReachDatabase& db, const NeighborGraph& graph, const IKSolverPool& solvers,
+                                    utils::ThreadPool& pool, const std::size_t grain_size);
+
+}  // namespace core
+}  // namespace reach
+
+#endif  // REACH_CORE_REGION_ANALYSIS_H
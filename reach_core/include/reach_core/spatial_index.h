@@ -0,0 +1,261 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef REACH_CORE_SPATIAL_INDEX_H
+#define REACH_CORE_SPATIAL_INDEX_H
+
+#include <Eigen/Core>
+#include <pcl/search/kdtree.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace reach
+{
+namespace core
+{
+/**
+ * @brief The SpatialIndex class is the interface for structures that find the points near a query point. Points are
+ * identified by their index in the list of points from which the index was built
+ */
+class SpatialIndex
+{
+public:
+  virtual ~SpatialIndex() = default;
+
+  /**
+   * @brief build indexes the input points, replacing the previously indexed points
+   * @param points
+   */
+  virtual void build(const std::vector<Eigen::Vector3f>& points) = 0;
+
+  /**
+   * @brief radiusSearch finds the points that lie within the input radius of the query point, including points that
+   * coincide with the query point
+   * @param query
+   * @param radius
+   * @param indices output indices of the points found, in no particular order
+   */
+  virtual void radiusSearch(const Eigen::Vector3f& query, const double radius,
+                            std::vector<std::size_t>& indices) const = 0;
+
+  /**
+   * @brief nearestKSearch finds the k points closest to the query point
+   * @param query
+   * @param k
+   * @param indices output indices of the points found, sorted by increasing distance
+   */
+  virtual void nearestKSearch(const Eigen::Vector3f& query, const std::size_t k,
+                              std::vector<std::size_t>& indices) const = 0;
+};
+typedef std::shared_ptr<SpatialIndex> SpatialIndexPtr;
+
+/**
+ * @brief The KdTreeIndex class indexes points with a PCL (FLANN) KD-tree
+ */
+class KdTreeIndex : public SpatialIndex
+{
+public:
+  void build(const std::vector<Eigen::Vector3f>& points) override;
+
+  void radiusSearch(const Eigen::Vector3f& query, const double radius,
+                    std::vector<std::size_t>& indices) const override;
+
+  void nearestKSearch(const Eigen::Vector3f& query, const std::size_t k,
+                      std::vector<std::size_t>& indices) const override;
+
+private:
+  pcl::search::KdTree<pcl::PointXYZ>::Ptr tree_;
+};
+
+/**
+ * @brief The BruteForceIndex class finds points by comparing the query point with every point. The coordinates are
+ * stored in separate contiguous arrays (structure of arrays) and the distances are computed a block of points at a
+ * time with Eigen array expressions, which Eigen vectorizes with the SIMD instructions of the target (e.g. SSE/AVX or
+ * NEON). For small clouds this is faster than traversing a KD-tree, and building the index only copies the points
+ */
+class BruteForceIndex : public SpatialIndex
+{
+public:
+  void build(const std::vector<Eigen::Vector3f>& points) override;
+
+  void radiusSearch(const Eigen::Vector3f& query, const double radius,
+                    std::vector<std::size_t>& indices) const override;
+
+  void nearestKSearch(const Eigen::Vector3f& query, const std::size_t k,
+                      std::vector<std::size_t>& indices) const override;
+
+private:
+  Eigen::ArrayXf x_;
+  Eigen::ArrayXf y_;
+  Eigen::ArrayXf z_;
+};
+
+/**
+ * @brief The VoxelGridIndex class hashes the points into a uniform grid of cubic cells. A radius search only visits
+ * the cells that overlap the bounding box of the search sphere (27 cells when the radius equals the cell size), so it
+ * is efficient for uniformly sampled surfaces searched with a fixed radius close to the cell size. The points are
+ * stored sorted by cell, such that the points of a cell are contiguous in memory, and searches do not allocate memory
+ * beyond the output indices
+ */
+class VoxelGridIndex : public SpatialIndex
+{
+public:
+  /**
+   * @brief VoxelGridIndex
+   * @param cell_size edge length of the cells, ideally the radius of the searches
+   */
+  explicit VoxelGridIndex(const double cell_size);
+
+  void build(const std::vector<Eigen::Vector3f>& points) override;
+
+  void radiusSearch(const Eigen::Vector3f& query, const double radius,
+                    std::vector<std::size_t>& indices) const override;
+
+  void nearestKSearch(const Eigen::Vector3f& query, const std::size_t k,
+                      std::vector<std::size_t>& indices) const override;
+
+private:
+  struct CellHash
+  {
+    std::size_t operator()(const Eigen::Vector3i& cell) const;
+  };
+
+  struct CellEqual
+  {
+    bool operator()(const Eigen::Vector3i& a, const Eigen::Vector3i& b) const
+    {
+      return a == b;
+    }
+  };
+
+  Eigen::Vector3i cellOf(const Eigen::Vector3f& point) const;
+
+  /**
+   * @brief Calls the input function with the position in the sorted arrays and the squared distance of each point that
+   * lies within the radius of the query point
+   */
+  template <typename Function>
+  void forEachInRadius(const Eigen::Vector3f& query, const double radius, Function&& fn) const;
+
+  float cell_size_;
+
+  // Range of the points of each non-empty cell in the arrays below
+  std::unordered_map<Eigen::Vector3i, std::pair<uint32_t, uint32_t>, CellHash, CellEqual> cells_;
+
+  // Positions and original indices of the points, sorted by cell
+  std::vector<Eigen::Vector3f> points_;
+  std::vector<std::size_t> indices_;
+
+  // Bounds of the occupied cells
+  Eigen::Vector3i min_cell_;
+  Eigen::Vector3i max_cell_;
+};
+
+/**
+ * @brief Number of points below which makeSpatialIndex creates a BruteForceIndex rather than a KdTreeIndex. Around this
+ * size a brute-force radius search takes about as long as a KD-tree search
+ */
+const std::size_t BRUTE_FORCE_MAX_POINTS = 2048;
+
+/**
+ * @brief makeSpatialIndex creates the type of spatial index that is fastest to query for the input number of points
+ * @param n_points
+ * @return
+ */
+SpatialIndexPtr makeSpatialIndex(const std::size_t n_points);
+
+/**
+ * @brief Creates an empty spatial index for the input number of points
+ */
+using SpatialIndexFactory = std::function<SpatialIndexPtr(const std::size_t n_points)>;
+
+/**
+ * @brief getSpatialIndexFactory returns the factory of the spatial index type with the input name:
+ *  - "auto": chooses the type by the number of points (see makeSpatialIndex)
+ *  - "kdtree": KdTreeIndex
+ *  - "brute_force": BruteForceIndex
+ *  - "voxel_grid": VoxelGridIndex with the input cell size
+ * @param name
+ * @param cell_size
+ * @return the factory, or an empty function if the name is not known
+ */
+SpatialIndexFactory getSpatialIndexFactory(const std::string& name, const double cell_size);
+
+/**
+ * @brief The OrientedSpatialIndex class finds the points near a query point whose directions (e.g. the z-axes of the
+ * target poses, which point along the surface normals of the reach object) lie within an angle of the query direction.
+ * The points are partitioned into bins of similar direction, by the face and cell of the cube onto which their
+ * directions project, and each bin is indexed separately. Each bin is bounded by a cone around the mean direction of
+ * its points, so a query only searches the bins whose cones lie within the angle of the query direction. Points on the
+ * opposite side of a thin part (whose directions are flipped) are therefore never searched
+ */
+class OrientedSpatialIndex
+{
+public:
+  using Factory = SpatialIndexFactory;
+
+  /**
+   * @brief OrientedSpatialIndex
+   * @param factory creates the index of the positions of the points of each bin, given the number of points of the bin
+   */
+  explicit OrientedSpatialIndex(const Factory& factory = makeSpatialIndex);
+
+  /**
+   * @brief build indexes the input points and directions, replacing the previously indexed points
+   * @param points
+   * @param directions unit direction of each point
+   */
+  void build(const std::vector<Eigen::Vector3f>& points, const std::vector<Eigen::Vector3f>& directions);
+
+  /**
+   * @brief radiusSearch finds the points that lie within the input radius of the query point and whose directions lie
+   * within the input angle of the query direction
+   * @param query
+   * @param direction unit query direction
+   * @param radius
+   * @param max_angle maximum angle (radians) between the query direction and the direction of a point
+   * @param indices output indices of the points found, in no particular order
+   */
+  void radiusSearch(const Eigen::Vector3f& query, const Eigen::Vector3f& direction, const double radius,
+                    const double max_angle, std::vector<std::size_t>& indices) const;
+
+private:
+  struct Bin
+  {
+    SpatialIndexPtr index;
+
+    // Index of each of the points of the bin in the list of all points
+    std::vector<std::size_t> points;
+
+    // Cone containing the directions of the points of the bin
+    Eigen::Vector3f axis;
+    double half_angle;
+  };
+
+  Factory factory_;
+  std::vector<Eigen::Vector3f> directions_;
+  std::vector<Bin> bins_;
+};
+typedef std::shared_ptr<OrientedSpatialIndex> OrientedSpatialIndexPtr;
+
+}  // namespace core
+}  // namespace reach
+
+#endif  // REACH_CORE_SPATIAL_INDEX_H
@@ -41,6 +41,12 @@ struct StudyOptimization
   int max_steps;
   float step_improvement_threshold;
   float radius;
+  // Maximum angle (radians) between the target z-axes of neighboring points; pi or more disables the check
+  float max_neighbor_angle;
+  // Type of spatial index used to find neighboring points (see getSpatialIndexFactory)
+  std::string spatial_index;
+  // Seed of the random order in which points are optimized
+  int seed;
 };
 
 /**
@@ -59,6 +65,9 @@ struct StudyParameters
   std::vector<std::string> compare_dbs;
   std::string fixed_frame;
   std::string object_frame;
+  int grain_size;
+  int checkpoint_interval;
+  bool compact_database;
 };
 
 }  // namespace core
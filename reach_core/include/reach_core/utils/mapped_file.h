@@ -0,0 +1,75 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef REACH_UTILS_MAPPED_FILE_H
+#define REACH_UTILS_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace reach
+{
+namespace utils
+{
+/**
+ * @brief The MappedFile class maps the contents of a file into memory read-only, such that a file can be read without
+ * copying it into a heap buffer. The operating system pages the contents in as they are accessed
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * @brief open maps the file at the input location, unmapping the previously mapped file, if any
+   * @param path
+   * @return true on success, false on failure
+   */
+  bool open(const std::string& path);
+
+  /**
+   * @brief close unmaps the file
+   */
+  void close();
+
+  bool isOpen() const
+  {
+    return data_ != nullptr;
+  }
+
+  const uint8_t* data() const
+  {
+    return data_;
+  }
+
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+private:
+  const uint8_t* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+}  // namespace utils
+}  // namespace reach
+
+#endif  // REACH_UTILS_MAPPED_FILE_H
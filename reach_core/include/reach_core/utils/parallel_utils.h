@@ -0,0 +1,100 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef REACH_UTILS_PARALLEL_UTILS_H
+#define REACH_UTILS_PARALLEL_UTILS_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reach
+{
+namespace utils
+{
+/**
+ * @brief The ThreadPool class runs parallel loops on a fixed set of worker threads, which are created once and reused
+ * by every loop rather than created and joined for each loop. Worker 0 is the thread that runs the loop, so a pool of
+ * n workers owns n - 1 threads
+ */
+class ThreadPool
+{
+public:
+  /**
+   * @brief ThreadPool
+   * @param n_workers number of workers, including the calling thread (at least 1)
+   */
+  explicit ThreadPool(const std::size_t n_workers);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * @brief parallelFor calls the input function once for every index on the interval [0, n) using a work-stealing
+   * scheduler. The indices are grouped into chunks of grain_size consecutive indices, and the chunks are divided evenly
+   * between the workers. A worker that runs out of chunks steals half of the remaining chunks of another worker, such
+   * that the workers stay busy even when the cost per index varies greatly. Worker 0 runs on the calling thread. If
+   * the function throws, the remaining chunks are abandoned and the first exception is rethrown once all workers have
+   * stopped. Loops started from different threads run one at a time; the function must not start a loop on the same
+   * pool
+   * @param n number of indices
+   * @param grain_size number of consecutive indices processed by a worker before it checks for more work
+   * @param fn function called with an index and the index of the worker on which it runs
+   */
+  void parallelFor(const std::size_t n, const std::size_t grain_size,
+                   const std::function<void(const std::size_t index, const std::size_t worker)>& fn);
+
+  /**
+   * @brief size returns the number of workers, including the calling thread
+   * @return
+   */
+  std::size_t size() const
+  {
+    return threads_.size() + 1;
+  }
+
+private:
+  struct Loop;
+
+  void run(const std::size_t worker);
+
+  std::vector<std::thread> threads_;
+
+  // Serializes the loops
+  std::mutex loop_mutex_;
+
+  // Guards the members below
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable finish_;
+  Loop* loop_ = nullptr;
+  uint64_t generation_ = 0;
+  std::size_t n_active_ = 0;
+  std::size_t n_running_ = 0;
+  bool stop_ = false;
+};
+typedef std::shared_ptr<ThreadPool> ThreadPoolPtr;
+
+}  // namespace utils
+}  // namespace reach
+
+#endif  // REACH_UTILS_PARALLEL_UTILS_H
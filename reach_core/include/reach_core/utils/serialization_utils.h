@@ -16,11 +16,13 @@
 #ifndef REACH_UTILS_DATABASE_UTILS_H
 #define REACH_UTILS_DATABASE_UTILS_H
 
+#include <cstring>
 #include <fstream>
 #include <reach_msgs/ReachRecord.h>
 #include "ros/console.h"
 #include <ros/serialization.h>
 #include <string>
+#include <vector>
 
 namespace reach
 {
@@ -73,6 +75,111 @@ bool fromFile(const std::string& path, T& msg)
   return true;
 }
 
+/**
+ * @brief appendToFile appends the input messages to a file, each prefixed with its serialized length, such that a file
+ * can be extended incrementally without rewriting its existing contents
+ * @param path
+ * @param msgs
+ * @return
+ */
+template <class T>
+bool appendToFile(const std::string& path, const std::vector<T>& msgs)
+{
+  namespace ser = ros::serialization;
+
+  std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+  if (!file)
+  {
+    return false;
+  }
+
+  std::vector<uint8_t> buffer;
+  for (const T& msg : msgs)
+  {
+    const uint32_t serialize_size = ser::serializationLength(msg);
+    buffer.resize(sizeof(uint32_t) + serialize_size);
+    std::memcpy(buffer.data(), &serialize_size, sizeof(uint32_t));
+
+    ser::OStream stream(buffer.data() + sizeof(uint32_t), serialize_size);
+    ser::serialize(stream, msg);
+
+    file.write((char*)buffer.data(), buffer.size());
+  }
+
+  file.flush();
+  return file.good();
+}
+
+/**
+ * @brief fromAppendedFile reads the messages of a file written by appendToFile. A truncated or corrupt final message
+ * (e.g. from a write interrupted by a crash) is ignored
+ * @param path
+ * @param msgs
+ * @param offset position in the file of the first message, e.g. to skip a header written before the messages
+ * @param end optional output position in the file after the last complete message, at which the file must be
+ * truncated before appending more messages if a truncated or corrupt message was ignored
+ * @return false if the file could not be opened
+ */
+template <class T>
+bool fromAppendedFile(const std::string& path, std::vector<T>& msgs, const std::streamoff offset = 0,
+                      std::streamoff* end = nullptr)
+{
+  namespace ser = ros::serialization;
+
+  std::ifstream ifs(path.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs || !ifs.seekg(0, std::ios::end))
+  {
+    return false;
+  }
+  const std::streamoff file_size = ifs.tellg();
+
+  std::streamoff position = offset;
+  if (!ifs.seekg(position))
+  {
+    return false;
+  }
+
+  std::vector<uint8_t> buffer;
+  uint32_t serialize_size;
+  while (ifs.read((char*)&serialize_size, sizeof(uint32_t)))
+  {
+    // Do not trust a corrupt length with an allocation larger than the rest of the file
+    const std::streamoff remaining = file_size - position - static_cast<std::streamoff>(sizeof(uint32_t));
+    if (static_cast<std::streamoff>(serialize_size) > remaining)
+    {
+      ROS_WARN_STREAM("Ignoring truncated or corrupt message at the end of '" << path << "'");
+      break;
+    }
+
+    buffer.resize(serialize_size);
+    if (!ifs.read((char*)buffer.data(), serialize_size))
+    {
+      ROS_WARN_STREAM("Ignoring truncated message at the end of '" << path << "'");
+      break;
+    }
+
+    T msg;
+    try
+    {
+      ser::IStream stream(buffer.data(), serialize_size);
+      ser::deserialize(stream, msg);
+    }
+    catch (const ser::StreamOverrunException& ex)
+    {
+      ROS_WARN_STREAM("Ignoring corrupt message at the end of '" << path << "': " << ex.what());
+      break;
+    }
+    msgs.push_back(std::move(msg));
+    position += static_cast<std::streamoff>(sizeof(uint32_t) + serialize_size);
+  }
+
+  if (end)
+  {
+    *end = position;
+  }
+  return true;
+}
+
 }  // namespace utils
 }  // namespace reach
 
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "reach_core/reach_database.h"
+#include <algorithm>
+#include <iostream>
+
+/**
+ * Converts a reach study database saved in the ROS serialized format to the columnar format, optionally with the
+ * compact encoding. The database is converted in place unless an output file is specified
+ */
+int main(int argc, char** argv)
+{
+  std::vector<std::string> args(argv + 1, argv + argc);
+  auto compact_flag = std::find(args.begin(), args.end(), "--compact");
+  const bool compact = compact_flag != args.end();
+  if (compact)
+  {
+    args.erase(compact_flag);
+  }
+
+  if (args.empty() || args.size() > 2)
+  {
+    std::cout << "Usage: convert_database [--compact] <input_file> [output_file]" << std::endl;
+    return -1;
+  }
+
+  const std::string input = args[0];
+  const std::string output = args.size() == 2 ? args[1] : input;
+
+  reach::core::ReachDatabase db;
+  if (!db.load(input))
+  {
+    std::cerr << "Failed to load reach database '" << input << "'" << std::endl;
+    return -1;
+  }
+
+  try
+  {
+    db.save(output, compact);
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << ex.what() << std::endl;
+    return -1;
+  }
+
+  std::cout << "Converted '" << input << "' to '" << output << "'" << std::endl;
+  return 0;
+}
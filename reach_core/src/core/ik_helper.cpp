@@ -16,178 +16,297 @@
 #include <eigen_conversions/eigen_msg.h>
 #include <reach_core/ik_helper.h>
 
+#include <algorithm>
+#include <deque>
+#include <numeric>
+
 namespace reach
 {
 namespace core
 {
-std::vector<std::string> getNeighbors(const reach_msgs::ReachRecord& rec, const ReachDatabasePtr db,
-                                      const double radius)
+namespace
+{
+/**
+ * @brief Returns the indices of the records within the radius of the input record, using the neighbor graph if the
+ * record is in it
+ */
+std::vector<std::size_t> findNeighbors(const ReachDatabase& db, const std::size_t index,
+                                       const reach_msgs::ReachRecord& rec, const double radius,
+                                       const NeighborGraphConstPtr& graph)
+{
+  if (graph && index < graph->size())
+  {
+    const NeighborGraph::Range neighbors = graph->neighbors(index);
+    return std::vector<std::size_t>(neighbors.begin(), neighbors.end());
+  }
+
+  return db.radiusSearch(rec.goal.position, radius);
+}
+
+}  // namespace
+
+std::vector<NeighborSolution> solveNeighbors(const ReachDatabase& db, const std::size_t index,
+                                             const reach_msgs::ReachRecord& rec,
+                                             reach::plugins::IKSolverBasePtr solver, const double radius,
+                                             NeighborGraphConstPtr graph,
+                                             std::vector<std::string>* reached_pts)
 {
-  const float x = rec.goal.position.x;
-  const float y = rec.goal.position.y;
-  const float z = rec.goal.position.z;
+  std::vector<NeighborSolution> solutions;
 
-  // Create vectors for storing poses and reach record messages that lie within radius of current point
-  std::vector<std::string> reach_records;
+  // Get all of the neighboring points
+  const std::vector<std::size_t> neighbors = findNeighbors(db, index, rec, radius, graph);
 
-  // Iterate through all points in database to find those that lie within radius of current point
-  for (auto it = db->begin(); it != db->end(); ++it)
+  // Solve IK for points that lie within sphere
+  if (!neighbors.empty())
   {
-    float xp = it->second.goal.position.x;
-    float yp = it->second.goal.position.y;
-    float zp = it->second.goal.position.z;
-    float d2 = std::pow((xp - x), 2.0f) + std::pow((yp - y), 2.0f) + std::pow((zp - z), 2.0f);
+    std::map<std::string, double> previous_solution;
+    for (std::size_t i = 0; i < rec.goal_state.position.size(); ++i)
+    {
+      previous_solution.emplace(rec.goal_state.name[i], rec.goal_state.position[i]);
+    }
 
-    if (d2 < std::pow(radius, 2.0f) && d2 != 0.0f)
+    for (std::size_t i = 0; i < neighbors.size(); ++i)
     {
-      reach_records.push_back(it->first);
+      // Initialize new target pose and new empty robot goal state
+      // Skip indices that do not contain a record (e.g. when resuming from a partial checkpoint)
+      if (neighbors[i] == index)
+        continue;
+      const boost::optional<reach_msgs::ReachRecord> lookup = db.get(neighbors[i]);
+      if (!lookup)
+        continue;
+      const reach_msgs::ReachRecord& neighbor = *lookup;
+
+      Eigen::Isometry3d target;
+      tf::poseMsgToEigen(neighbor.goal, target);
+
+      // Use current point's IK solution as seed
+      std::vector<double> new_solution;
+      const boost::optional<double> score = solver->solveIKFromSeed(target, previous_solution, new_solution);
+
+      if (score)
+      {
+        // Keep the solution if currently solved point didn't have solution before or if its current manipulability is
+        // better than that saved in the database
+        if (!neighbor.reached || *score > neighbor.score)
+          solutions.push_back(NeighborSolution{ neighbors[i], rec.goal_state.position, new_solution, *score });
+
+        if (reached_pts)
+          reached_pts->push_back(neighbor.id);
+      }
     }
   }
 
-  return reach_records;
+  return solutions;
 }
 
-std::vector<std::string> getNeighborsFLANN(const reach_msgs::ReachRecord& rec, const ReachDatabasePtr db,
-                                           const double radius, SearchTreePtr search_tree)
+NeighborReachResult reachNeighborsDirect(ReachDatabasePtr db, const reach_msgs::ReachRecord& rec,
+                                         reach::plugins::IKSolverBasePtr solver, const double radius,
+                                         NeighborGraphConstPtr graph)
 {
-  pcl::PointXYZ query(rec.goal.position.x, rec.goal.position.y, rec.goal.position.z);
-  std::vector<int> indices;
-  std::vector<float> distances;
-  search_tree->radiusSearch(query, radius, indices, distances);
+  // Initialize return array of string IDs of msgs that have been updated
+  NeighborReachResult result;
 
-  std::vector<std::string> neighbors;
-  for (std::size_t i = 0; i < indices.size(); ++i)
+  // Records that are not in the database get an index past its end, which is not the index of any neighbor
+  const std::size_t index = db->indexOf(rec.id).value_or(db->size());
+  for (const NeighborSolution& solution :
+       solveNeighbors(*db, index, rec, solver, radius, graph, &result.reached_pts))
   {
-    auto it = db->begin();
-    std::advance(it, indices[i]);
-    neighbors.push_back(it->first);
+    // Change database if the solution is better than the record. The comparison is made atomically by the database in
+    // case the record was changed since it was read
+    if (db->updateIfBetter(solution.index, solution.seed_position, solution.goal_position, solution.score))
+      result.updated_pts.push_back(solution.index);
   }
 
-  return neighbors;
+  return result;
 }
 
-NeighborReachResult reachNeighborsDirect(ReachDatabasePtr db, const reach_msgs::ReachRecord& rec,
-                                         reach::plugins::IKSolverBasePtr solver, const double radius,
-                                         SearchTreePtr search_tree)
+NeighborReachResult reachNeighborsRecursive(ReachDatabasePtr db, const reach_msgs::ReachRecord& rec,
+                                            reach::plugins::IKSolverBasePtr solver, const double radius,
+                                            NeighborGraphConstPtr graph, std::vector<bool>* visited)
 {
-  // Initialize return array of string IDs of msgs that have been updated
   NeighborReachResult result;
 
-  // Get all of the neighboring points
-  std::vector<std::string> neighbors;
-  if (search_tree)
+  // Add the current point to the output list of msg IDs
+  result.reached_pts.push_back(rec.id);
+
+  std::vector<bool> local_visited;
+  if (!visited)
   {
-    neighbors = getNeighborsFLANN(rec, db, radius, search_tree);
+    local_visited.resize(db->size(), false);
+    visited = &local_visited;
   }
-  else
+  else if (visited->size() < db->size())
   {
-    neighbors = getNeighbors(rec, db, radius);
+    visited->resize(db->size(), false);
   }
 
-  // Solve IK for points that lie within sphere
-  if (!neighbors.empty())
+  // Indices of the records marked as visited, such that only their bits need to be cleared afterwards
+  std::vector<std::size_t> touched;
+
+  const boost::optional<std::size_t> rec_index = db->indexOf(rec.id);
+  if (rec_index)
   {
-    std::map<std::string, double> previous_solution;
-    for (std::size_t i = 0; i < rec.goal_state.position.size(); ++i)
+    (*visited)[*rec_index] = true;
+    touched.push_back(*rec_index);
+  }
+
+  // Points that have been reached, and the joint positions with which they were reached, in the order in which they
+  // were reached. The points are expanded breadth-first
+  struct Reached
+  {
+    geometry_msgs::Point position;
+    boost::optional<std::size_t> index;
+    std::vector<double> joint_positions;
+  };
+  std::deque<Reached> queue;
+  queue.push_back(Reached{ rec.goal.position, rec_index, rec.goal_state.position });
+
+  const std::vector<std::string>& joint_names = rec.goal_state.name;
+  std::map<std::string, double> current_pose_map;
+  std::vector<double> new_pose;
+  while (!queue.empty())
+  {
+    const Reached current = std::move(queue.front());
+    queue.pop_front();
+
+    for (std::size_t i = 0; i < joint_names.size(); ++i)
     {
-      previous_solution.emplace(rec.goal_state.name[i], rec.goal_state.position[i]);
+      current_pose_map[joint_names[i]] = current.joint_positions[i];
     }
 
-    for (std::size_t i = 0; i < neighbors.size(); ++i)
+    std::vector<std::size_t> neighbors;
+    if (graph && current.index && *current.index < graph->size())
     {
-      // Initialize new target pose and new empty robot goal state
+      const NeighborGraph::Range range = graph->neighbors(*current.index);
+      neighbors.assign(range.begin(), range.end());
+    }
+    else
+    {
+      neighbors = db->radiusSearch(current.position, radius);
+    }
+
+    for (const std::size_t n : neighbors)
+    {
+      // Skip the neighbors that have already been reached
+      if (n >= visited->size() || (*visited)[n])
+        continue;
+
+      const boost::optional<reach_msgs::ReachRecord> neighbor = db->get(n);
+      if (!neighbor)
+        continue;
+
       Eigen::Isometry3d target;
-      tf::poseMsgToEigen(db->get(neighbors[i])->goal, target);
+      tf::poseMsgToEigen(neighbor->goal, target);
 
       // Use current point's IK solution as seed
-      std::vector<double> new_solution;
-      boost::optional<double> score = solver->solveIKFromSeed(target, previous_solution, new_solution);
-
+      new_pose.clear();
+      boost::optional<double> score = solver->solveIKFromSeed(target, current_pose_map, new_pose);
       if (score)
       {
-        // Change database if currently solved point didn't have solution before
-        // or if its current manipulability is better than that saved in the databas
-        reach_msgs::ReachRecord msg = *(db->get(neighbors[i]));
-
-        if (!msg.reached || (*score > msg.score))
+        // Calculate the joint distance between the seed and new goal states
+        for (std::size_t j = 0; j < current.joint_positions.size(); ++j)
         {
-          // Overwrite Reach Record msg parameters with new results
-          msg.reached = true;
-          msg.seed_state.position = rec.goal_state.position;
-          msg.goal_state.position = new_solution;
-          msg.score = *score;
-          db->put(msg);
+          result.joint_distance += std::abs(new_pose[j] - current.joint_positions[j]);
         }
 
-        // Populate return array of changed points
-        result.reached_pts.push_back(msg.id);
+        (*visited)[n] = true;
+        touched.push_back(n);
+        result.reached_pts.push_back(neighbor->id);
+
+        // Continue from the new neighboring location
+        queue.push_back(Reached{ neighbor->goal.position, n, new_pose });
       }
     }
   }
+
+  // Leave the visited flags cleared for the next call
+  for (const std::size_t i : touched)
+  {
+    (*visited)[i] = false;
+  }
+
   return result;
 }
 
-void reachNeighborsRecursive(ReachDatabasePtr db, const reach_msgs::ReachRecord& rec,
-                             reach::plugins::IKSolverBasePtr solver, const double radius, NeighborReachResult result,
-                             SearchTreePtr search_tree)
+std::vector<std::vector<std::size_t>> colorNeighborhoods(const NeighborGraph& graph, const std::size_t min_group_size)
 {
-  // Add the current point to the output list of msg IDs
-  result.reached_pts.push_back(rec.id);
+  const std::size_t n = graph.size();
 
-  // Create vectors for storing reach record messages that lie within radius of current point
-  std::vector<std::string> neighbors;
-  if (search_tree)
-  {
-    neighbors = getNeighborsFLANN(rec, db, radius, search_tree);
-  }
-  else
+  // Flags the colors taken by the neighbors and the neighbors of neighbors of a record. The graph is symmetric, so
+  // these are exactly the records whose neighborhoods overlap that of the record
+  std::vector<int> colors(n, -1);
+  std::vector<bool> taken;
+  auto findTaken = [&](const std::size_t i, const std::size_t n_colors) {
+    taken.assign(n_colors, false);
+    auto take = [&](const std::size_t idx) {
+      if (colors[idx] >= 0)
+        taken[colors[idx]] = true;
+    };
+
+    for (const uint32_t neighbor : graph.neighbors(i))
+    {
+      take(neighbor);
+      for (const uint32_t second : graph.neighbors(neighbor))
+        take(second);
+    }
+  };
+
+  // Greedily assign each record the lowest color not already taken
+  std::vector<std::size_t> sizes;
+  for (std::size_t i = 0; i < n; ++i)
   {
-    neighbors = getNeighbors(rec, db, radius);
+    findTaken(i, sizes.size() + 1);
+    const int color = static_cast<int>(std::distance(taken.begin(), std::find(taken.begin(), taken.end(), false)));
+    if (color == static_cast<int>(sizes.size()))
+      sizes.push_back(0);
+
+    colors[i] = color;
+    ++sizes[color];
   }
 
-  // Solve IK for points that lie within sphere
-  if (neighbors.size() > 0)
+  // The greedy coloring leaves a long tail of groups with only a few members. Starting with the smallest group, move
+  // the members of the small groups to the largest group in which they have no conflicts
+  std::vector<int> order(sizes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](const int lhs, const int rhs) { return sizes[lhs] < sizes[rhs]; });
+
+  std::vector<std::vector<std::size_t>> members(sizes.size());
+  for (std::size_t i = 0; i < n; ++i)
+    members[colors[i]].push_back(i);
+
+  for (const int color : order)
   {
-    for (std::size_t i = 0; i < neighbors.size(); ++i)
-    {
-      const std::vector<double>& current_pose = rec.goal_state.position;
+    if (sizes[color] >= min_group_size)
+      continue;
 
-      std::map<std::string, double> current_pose_map;
-      for (std::size_t i = 0; i < current_pose.size(); ++i)
+    for (const std::size_t i : members[color])
+    {
+      findTaken(i, sizes.size());
+      int target = -1;
+      for (int c = 0; c < static_cast<int>(sizes.size()); ++c)
       {
-        current_pose_map.emplace(rec.goal_state.name[i], current_pose[i]);
+        if (c != color && !taken[c] && sizes[c] > 0 && (target < 0 || sizes[c] > sizes[target]))
+          target = c;
       }
 
-      // Check if the current potential point has been solved previously in the recursion chain
-      if (std::find(result.reached_pts.begin(), result.reached_pts.end(), neighbors[i]) == std::end(result.reached_pts))
+      if (target >= 0)
       {
-        std::vector<double> new_pose;
-        Eigen::Isometry3d target;
-        tf::poseMsgToEigen(db->get(neighbors[i])->goal, target);
-
-        // Use current point's IK solution as seed
-        boost::optional<double> score = solver->solveIKFromSeed(target, current_pose_map, new_pose);
-        if (score)
-        {
-          // Calculate the joint distance between the seed and new goal states
-          for (std::size_t j = 0; j < current_pose.size(); ++j)
-          {
-            result.joint_distance += std::abs(new_pose[j] - current_pose[j]);
-          }
-
-          // Store information in new reach record object
-          reach_msgs::ReachRecord new_rec(*db->get(neighbors[i]));
-          new_rec.seed_state.position = current_pose;
-          new_rec.goal_state.position = new_pose;
-          new_rec.reached = true;
-          new_rec.score = *score;
-
-          // Recursively enter this function at the new neighboring location
-          reachNeighborsRecursive(db, new_rec, solver, radius, result, search_tree);
-        }
+        colors[i] = target;
+        --sizes[color];
+        ++sizes[target];
       }
     }
   }
+
+  // Collect the members of the remaining groups
+  std::vector<std::vector<std::size_t>> groups(sizes.size());
+  for (std::size_t i = 0; i < n; ++i)
+    groups[colors[i]].push_back(i);
+
+  groups.erase(std::remove_if(groups.begin(), groups.end(),
+                              [](const std::vector<std::size_t>& group) { return group.empty(); }),
+               groups.end());
+  return groups;
 }
 
 }  // namespace core
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <reach_core/ik_solver_pool.h>
+#include <ros/console.h>
+
+namespace reach
+{
+namespace core
+{
+IKSolverPool::IKSolverPool(reach::plugins::IKSolverBasePtr prototype, const std::size_t size, const Factory& factory)
+  : prototype_(prototype)
+{
+  solvers_.reserve(size);
+
+  // A single worker can use the prototype itself, since no other thread uses it
+  if (size == 1)
+  {
+    solvers_.push_back(prototype_);
+    return;
+  }
+
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    reach::plugins::IKSolverBasePtr solver = prototype_->clone();
+    if (!solver && factory)
+    {
+      solver = factory();
+    }
+
+    // Solvers are not required to be thread-safe, so the workers must not share one
+    if (!solver)
+    {
+      ROS_ERROR("Unable to create an independent IK solver for each worker; the IK solver supports neither cloning nor "
+                "creation by the factory");
+      solvers_.clear();
+      return;
+    }
+
+    solvers_.push_back(solver);
+  }
+}
+
+const reach::plugins::IKSolverBasePtr& IKSolverPool::get(const std::size_t worker) const
+{
+  return solvers_.at(worker);
+}
+
+std::size_t IKSolverPool::size() const
+{
+  return solvers_.size();
+}
+
+}  // namespace core
+}  // namespace reach
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <reach_core/neighbor_graph.h>
+#include <reach_core/utils/parallel_utils.h>
+
+#include <ros/console.h>
+
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+const char MAGIC[8] = { 'R', 'E', 'A', 'C', 'H', 'N', 'G', '\0' };
+const uint32_t FORMAT_VERSION = 2;
+
+// Number of records searched by a worker before it checks for more work
+const std::size_t GRAIN_SIZE = 64;
+
+/**
+ * @brief Header at the start of a neighbor graph file, followed by the offsets, the neighbors and the checksum of both.
+ * All values are stored in the native byte order
+ */
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t poses_checksum;
+  double radius;
+  uint64_t n_records;
+  uint64_t n_edges;
+  // Maximum angle between the goal z-axes of neighbors (since version 2)
+  double max_angle;
+};
+
+/**
+ * @brief Computes the checksum of the goal poses of the records of the database, which identifies the database from
+ * which a graph was built
+ */
+uint32_t posesChecksum(const reach::core::ReachDatabase& db)
+{
+  boost::crc_32_type crc;
+  for (std::size_t i = 0; i < db.size(); ++i)
+  {
+    const boost::optional<reach_msgs::ReachRecord> rec = db.get(i);
+    const geometry_msgs::Pose goal = rec ? rec->goal : geometry_msgs::Pose();
+    const double pose[8] = { rec ? 1.0 : 0.0, goal.position.x, goal.position.y, goal.position.z,
+                             goal.orientation.x, goal.orientation.y, goal.orientation.z, goal.orientation.w };
+    crc.process_bytes(pose, sizeof(pose));
+  }
+  return crc.checksum();
+}
+
+}  // namespace
+
+namespace reach
+{
+namespace core
+{
+void NeighborGraph::build(const ReachDatabase& db, const double radius, const double max_angle,
+                          utils::ThreadPool& pool)
+{
+  const std::size_t n = db.size();
+  const bool oriented = max_angle < M_PI;
+
+  // Find the neighbors of each record in parallel
+  std::vector<std::vector<uint32_t>> lists(n);
+  auto search = [&](const std::size_t i, const std::size_t /*worker*/) {
+    const boost::optional<reach_msgs::ReachRecord> rec = db.get(i);
+    if (!rec)
+      return;
+
+    const std::vector<std::size_t> found =
+        oriented ? db.radiusSearch(rec->goal, radius, max_angle) : db.radiusSearch(rec->goal.position, radius);
+    for (const std::size_t idx : found)
+    {
+      if (idx != i)
+        lists[i].push_back(static_cast<uint32_t>(idx));
+    }
+  };
+  pool.parallelFor(n, GRAIN_SIZE, search);
+
+  // Concatenate the lists
+  radius_ = radius;
+  max_angle_ = oriented ? max_angle : M_PI;
+  poses_checksum_ = posesChecksum(db);
+  offsets_.assign(n + 1, 0);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    offsets_[i + 1] = offsets_[i] + lists[i].size();
+  }
+
+  neighbors_.resize(offsets_[n]);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    std::copy(lists[i].begin(), lists[i].end(), neighbors_.begin() + offsets_[i]);
+  }
+}
+
+bool NeighborGraph::save(const std::string& filename) const
+{
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    ROS_ERROR_STREAM("Failed to open neighbor graph file '" << filename << "' for writing");
+    return false;
+  }
+
+  FileHeader header = {};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = FORMAT_VERSION;
+  header.poses_checksum = poses_checksum_;
+  header.radius = radius_;
+  header.max_angle = max_angle_;
+  header.n_records = size();
+  header.n_edges = numEdges();
+
+  boost::crc_32_type crc;
+  crc.process_bytes(offsets_.data(), offsets_.size() * sizeof(uint64_t));
+  crc.process_bytes(neighbors_.data(), neighbors_.size() * sizeof(uint32_t));
+  const uint32_t checksum = crc.checksum();
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(offsets_.data()), offsets_.size() * sizeof(uint64_t));
+  file.write(reinterpret_cast<const char*>(neighbors_.data()), neighbors_.size() * sizeof(uint32_t));
+  file.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+
+  if (!file)
+  {
+    ROS_ERROR_STREAM("Failed to write neighbor graph file '" << filename << "'");
+    return false;
+  }
+  return true;
+}
+
+bool NeighborGraph::load(const std::string& filename, const ReachDatabase& db, const double radius,
+                         const double max_angle)
+{
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+
+  FileHeader header = {};
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+  {
+    ROS_ERROR_STREAM("'" << filename << "' is not a valid neighbor graph file");
+    return false;
+  }
+
+  // Graphs written by other versions are simply rebuilt
+  if (header.version != FORMAT_VERSION)
+  {
+    ROS_INFO_STREAM("Neighbor graph file '" << filename << "' has unsupported version " << header.version);
+    return false;
+  }
+
+  // The graph must have been built from the same records with the same radius and angle
+  const double angle = max_angle < M_PI ? max_angle : M_PI;
+  if (header.radius != radius || header.max_angle != angle || header.n_records != db.size() ||
+      header.poses_checksum != posesChecksum(db))
+  {
+    ROS_INFO_STREAM("Neighbor graph file '" << filename << "' does not match the reach study database");
+    return false;
+  }
+
+  // Make sure the file is large enough for the sizes in the header before allocating memory for the graph
+  const std::streamoff begin = file.tellg();
+  file.seekg(0, std::ios::end);
+  const std::streamoff remaining = file.tellg() - begin;
+  file.seekg(begin);
+  const uint64_t max_entries = std::numeric_limits<uint64_t>::max() / sizeof(uint64_t) - 1;
+  if (header.n_records > max_entries || header.n_edges > max_entries ||
+      static_cast<uint64_t>(remaining) != (header.n_records + 1) * sizeof(uint64_t) +
+                                              header.n_edges * sizeof(uint32_t) + sizeof(uint32_t))
+  {
+    ROS_ERROR_STREAM("Neighbor graph file '" << filename << "' is corrupt");
+    return false;
+  }
+
+  std::vector<uint64_t> offsets(header.n_records + 1);
+  std::vector<uint32_t> neighbors(header.n_edges);
+  uint32_t checksum = 0;
+  file.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+  file.read(reinterpret_cast<char*>(neighbors.data()), neighbors.size() * sizeof(uint32_t));
+  file.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+
+  boost::crc_32_type crc;
+  crc.process_bytes(offsets.data(), offsets.size() * sizeof(uint64_t));
+  crc.process_bytes(neighbors.data(), neighbors.size() * sizeof(uint32_t));
+  if (!file || crc.checksum() != checksum || offsets.front() != 0 || offsets.back() != header.n_edges ||
+      !std::is_sorted(offsets.begin(), offsets.end()) ||
+      std::any_of(neighbors.begin(), neighbors.end(), [&](const uint32_t i) { return i >= header.n_records; }))
+  {
+    ROS_ERROR_STREAM("Neighbor graph file '" << filename << "' is corrupt");
+    return false;
+  }
+
+  radius_ = radius;
+  max_angle_ = angle;
+  poses_checksum_ = header.poses_checksum;
+  offsets_ = std::move(offsets);
+  neighbors_ = std::move(neighbors);
+  return true;
+}
+
+}  // namespace core
+}  // namespace reach
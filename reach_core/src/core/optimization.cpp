@@ -0,0 +1,152 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <reach_core/optimization.h>
+#include <reach_core/ik_helper.h>
+#include <reach_core/utils/general_utils.h>
+
+#include <ros/console.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace reach
+{
+namespace core
+{
+OptimizationResult optimizeReachDatabase(ReachDatabase& db, const std::vector<std::vector<std::size_t>>& groups,
+                                         NeighborGraphConstPtr graph, const IKSolverPool& solvers,
+                                         utils::ThreadPool& pool, const StudyOptimization& params,
+                                         const std::size_t grain_size)
+{
+  OptimizationResult result;
+
+  // Create sequential vector of groups to be randomized
+  std::vector<std::size_t> rand_vec(groups.size());
+  std::iota(rand_vec.begin(), rand_vec.end(), 0);
+
+  // Worklist of the points to optimize: a point only needs to be optimized (again) if its own solution changed since
+  // it was last optimized, since its neighbors were already attempted from its current solution otherwise. Initially
+  // all reached points are queued
+  std::vector<char> queued(db.size(), 0);
+  std::size_t n_queued = 0;
+  for (std::size_t i = 0; i < queued.size(); ++i)
+  {
+    const boost::optional<reach_msgs::ReachRecord> rec = db.get(i);
+    if (rec && rec->reached)
+    {
+      queued[i] = 1;
+      ++n_queued;
+    }
+  }
+
+  // Group of each point, to tell whether a point requeued during a pass is still to be optimized in that pass
+  std::vector<std::size_t> group_of(db.size(), groups.size());
+  for (std::size_t g = 0; g < groups.size(); ++g)
+  {
+    for (const std::size_t idx : groups[g])
+      group_of[idx] = g;
+  }
+  std::vector<char> visited(groups.size(), 0);
+
+  // Seeded generator of the order in which the groups are visited, such that the optimization is reproducible
+  std::mt19937 rng(static_cast<std::mt19937::result_type>(params.seed));
+
+  // Iterate
+  std::atomic<int> current_counter, previous_pct;
+  float previous_score = 0.0;
+  float pct_improve = 1.0;
+
+  while (n_queued > 0 && pct_improve > params.step_improvement_threshold && result.n_loops < params.max_steps)
+  {
+    ROS_INFO("Entering optimization loop %d with %lu queued points", result.n_loops, n_queued);
+    previous_score = db.getStudyResults().norm_total_pose_score;
+    current_counter = 0;
+    previous_pct = 0;
+    std::fill(visited.begin(), visited.end(), 0);
+
+    // Number of points optimized in this pass, which grows as points of groups not yet visited are requeued
+    int n_pass = static_cast<int>(n_queued);
+
+    // Randomize the order in which the groups are visited
+    std::shuffle(rand_vec.begin(), rand_vec.end(), rng);
+
+    for (const std::size_t g : rand_vec)
+    {
+      visited[g] = 1;
+
+      // Optimize the queued members of the group. Points updated by an earlier group of this pass are included, such
+      // that improvements propagate within the pass
+      std::vector<std::size_t> members;
+      for (const std::size_t idx : groups[g])
+      {
+        if (queued[idx])
+          members.push_back(idx);
+      }
+      if (members.empty())
+        continue;
+
+      // Solve the neighbors of the members against the database as of the start of the group, without changing it
+      std::vector<std::vector<NeighborSolution>> solutions(members.size());
+      auto optimize = [&](const std::size_t i, const std::size_t worker) {
+        queued[members[i]] = 0;
+        const boost::optional<reach_msgs::ReachRecord> msg = db.get(members[i]);
+        if (msg && msg->reached)
+          solutions[i] = solveNeighbors(db, members[i], *msg, solvers.get(worker), params.radius, graph);
+
+        // Print function progress
+        current_counter++;
+        utils::integerProgressPrinter(current_counter, previous_pct, n_pass);
+      };
+      pool.parallelFor(members.size(), grain_size, optimize);
+      n_queued -= members.size();
+
+      // Apply the solutions in the order of the members, such that the results do not depend on the number of threads
+      // or on the order in which they finished, and requeue the points whose solutions changed
+      for (const std::vector<NeighborSolution>& member_solutions : solutions)
+      {
+        for (const NeighborSolution& solution : member_solutions)
+        {
+          if (db.updateIfBetter(solution.index, solution.seed_position, solution.goal_position, solution.score) &&
+              !queued[solution.index])
+          {
+            queued[solution.index] = 1;
+            ++n_queued;
+            if (!visited[group_of[solution.index]])
+              ++n_pass;
+          }
+        }
+      }
+    }
+
+    // Report the optimized reach study results
+    db.printResults();
+    const float score = db.getStudyResults().norm_total_pose_score;
+    if (previous_score != 0.0f)
+      pct_improve = std::abs((score - previous_score) / previous_score);
+    else
+      pct_improve = score != 0.0f ? 1.0f : 0.0f;
+    ++result.n_loops;
+  }
+
+  result.converged = n_queued == 0;
+  return result;
+}
+
+}  // namespace core
+}  // namespace reach
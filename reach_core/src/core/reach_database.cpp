@@ -14,17 +14,59 @@
  * limitations under the License.
  */
 #include <reach_core/reach_database.h>
+#include <reach_core/reach_database_file.h>
+#include <reach_core/utils/mapped_file.h>
 #include <reach_core/utils/serialization_utils.h>
 
+#include <Eigen/Geometry>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
 namespace
 {
-reach_msgs::ReachDatabase toReachDatabase(const std::unordered_map<std::string, reach_msgs::ReachRecord>& map,
+const char CHECKPOINT_MAGIC[8] = { 'R', 'E', 'A', 'C', 'H', 'C', 'K', '\0' };
+const uint32_t CHECKPOINT_VERSION = 1;
+
+/**
+ * @brief Resolution of the fixed-point sums of the record scores. Integer sums are exact, so the total score does not
+ * depend on the order in which the records were added or changed
+ */
+const double SCORE_RESOLUTION = 1.0e-9;
+
+int64_t toFixedPoint(const double score)
+{
+  return static_cast<int64_t>(std::llround(score / SCORE_RESOLUTION));
+}
+
+/**
+ * @brief Header at the start of a checkpoint file, followed by the records appended by each checkpoint. All values are
+ * stored in the native byte order
+ */
+struct CheckpointHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t study_checksum;
+  uint64_t n_points;
+};
+
+reach_msgs::ReachDatabase toReachDatabase(const std::vector<reach_msgs::ReachRecord>& records,
                                           const reach::core::StudyResults& results)
 {
   reach_msgs::ReachDatabase msg;
-  for (auto it = map.begin(); it != map.end(); ++it)
+  msg.records.reserve(records.size());
+  for (const reach_msgs::ReachRecord& record : records)
   {
-    msg.records.push_back(it->second);
+    // Skip indices that do not contain a record
+    if (!record.id.empty())
+    {
+      msg.records.push_back(record);
+    }
   }
 
   msg.total_pose_score = results.total_pose_score;
@@ -36,6 +78,79 @@ reach_msgs::ReachDatabase toReachDatabase(const std::unordered_map<std::string,
   return msg;
 }
 
+/**
+ * @brief Writes records in the ROS serialized format of a reach_msgs::ReachDatabase message. The records are serialized
+ * and written one at a time, rather than building and serializing a copy of the full message
+ */
+bool writeLegacyFile(const std::string& filename, const std::vector<reach_msgs::ReachRecord>& records,
+                     const reach::core::StudyResults& results)
+{
+  namespace ser = ros::serialization;
+
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    return false;
+  }
+
+  // Skip indices that do not contain a record
+  auto is_present = [](const reach_msgs::ReachRecord& r) { return !r.id.empty(); };
+  const uint32_t n_records = static_cast<uint32_t>(std::count_if(records.begin(), records.end(), is_present));
+  file.write(reinterpret_cast<const char*>(&n_records), sizeof(n_records));
+
+  std::vector<uint8_t> buffer;
+  for (const reach_msgs::ReachRecord& record : records)
+  {
+    if (!is_present(record))
+      continue;
+
+    const uint32_t serialize_size = ser::serializationLength(record);
+    buffer.resize(serialize_size);
+    ser::OStream stream(buffer.data(), serialize_size);
+    ser::serialize(stream, record);
+    file.write(reinterpret_cast<const char*>(buffer.data()), serialize_size);
+  }
+
+  // The results follow the records in the order of the fields of the message
+  const float msg_results[] = { results.reach_percentage, results.total_pose_score, results.norm_total_pose_score,
+                                results.avg_num_neighbors, results.avg_joint_distance };
+  file.write(reinterpret_cast<const char*>(msg_results), sizeof(msg_results));
+
+  file.flush();
+  return file.good();
+}
+
+bool samePose(const geometry_msgs::Pose& a, const geometry_msgs::Pose& b)
+{
+  return a.position.x == b.position.x && a.position.y == b.position.y && a.position.z == b.position.z &&
+         a.orientation.x == b.orientation.x && a.orientation.y == b.orientation.y &&
+         a.orientation.z == b.orientation.z && a.orientation.w == b.orientation.w;
+}
+
+/**
+ * @brief Returns the z-axis of a goal pose, which points along the surface normal of the reach object at the target
+ */
+Eigen::Vector3f goalDirection(const geometry_msgs::Pose& goal)
+{
+  const Eigen::Quaterniond q(goal.orientation.w, goal.orientation.x, goal.orientation.y, goal.orientation.z);
+  if (q.norm() == 0.0)
+    return Eigen::Vector3f::UnitZ();
+  return (q.normalized() * Eigen::Vector3d::UnitZ()).cast<float>();
+}
+
+/**
+ * @brief Returns the index encoded in the ID of a record created by the reach study, if any
+ */
+boost::optional<std::size_t> parseIndex(const std::string& id)
+{
+  auto is_digit = [](const unsigned char c) { return std::isdigit(c) != 0; };
+  if (id.empty() || id.size() > 18 || !std::all_of(id.begin(), id.end(), is_digit))
+  {
+    return {};
+  }
+  return static_cast<std::size_t>(std::stoull(id));
+}
+
 }  // namespace
 
 namespace reach
@@ -66,106 +181,565 @@ std::map<std::string, double> jointStateMsgToMap(const sensor_msgs::JointState&
   return out;
 }
 
-void ReachDatabase::save(const std::string& filename) const
+void ReachDatabase::save(const std::string& filename, const bool compact) const
 {
-  std::lock_guard<std::mutex> lock{ mutex_ };
-  reach_msgs::ReachDatabase msg = toReachDatabase(map_, results_);
+  std::unique_lock<std::shared_timed_mutex> lock{ mutex_ };
 
-  if (!reach::utils::toFile(filename, msg))
+  // Write to a temporary file which replaces the previous database once complete, such that a crash while saving does
+  // not destroy the previous database
+  const std::string tmp_filename = filename + ".tmp";
+  bool written;
+  if (haveCommonJoints(records_))
+  {
+    written = writeColumnarDatabaseFile(tmp_filename, records_, getStudyResultsHelper(), compact);
+  }
+  else
   {
+    // Records whose joints differ cannot be stored in columns, so fall back to the ROS serialized format
+    ROS_WARN_STREAM("Saving database to '" << filename << "' in the legacy format; its records have different joints");
+    written = writeLegacyFile(tmp_filename, records_, getStudyResultsHelper());
+  }
+
+  if (!written || std::rename(tmp_filename.c_str(), filename.c_str()) != 0)
+  {
+    std::remove(tmp_filename.c_str());
     throw std::runtime_error("Unable to save database to file: " + filename);
   }
 }
 
 bool ReachDatabase::load(const std::string& filename)
 {
-  reach_msgs::ReachDatabase msg;
-  if (!reach::utils::fromFile(filename, msg))
+  if (isColumnarDatabaseFile(filename))
+  {
+    MappedReachDatabase file;
+    if (!file.open(filename) || !file.verify())
+    {
+      return false;
+    }
+
+    std::unique_lock<std::shared_timed_mutex> lock{ mutex_ };
+    records_.reserve(file.size());
+    for (std::size_t i = 0; i < file.size(); ++i)
+    {
+      if (file.contains(i))
+      {
+        putHelper(file.record(i));
+      }
+    }
+    results_.avg_num_neighbors = file.getStudyResults().avg_num_neighbors;
+    results_.avg_joint_distance = file.getStudyResults().avg_joint_distance;
+
+    for (Stripe& s : stripes_)
+    {
+      s.dirty.clear();
+    }
+    return true;
+  }
+
+  // Deserialize the records of the ROS serialized message one at a time directly from the mapped file, rather than
+  // reading the file into a buffer and deserializing a copy of the full message
+  reach::utils::MappedFile file;
+  if (!file.open(filename))
   {
     return false;
   }
 
-  std::lock_guard<std::mutex> lock{ mutex_ };
+  namespace ser = ros::serialization;
+  std::unique_lock<std::shared_timed_mutex> lock{ mutex_ };
+  try
+  {
+    ser::IStream stream(const_cast<uint8_t*>(file.data()), static_cast<uint32_t>(file.size()));
+
+    uint32_t n_records;
+    ser::deserialize(stream, n_records);
+
+    reach_msgs::ReachRecord record;
+    for (uint32_t i = 0; i < n_records; ++i)
+    {
+      ser::deserialize(stream, record);
+      putHelper(record);
+    }
 
-  for (const auto& r : msg.records)
+    float reach_percentage, total_pose_score, norm_total_pose_score;
+    ser::deserialize(stream, reach_percentage);
+    ser::deserialize(stream, total_pose_score);
+    ser::deserialize(stream, norm_total_pose_score);
+    ser::deserialize(stream, results_.avg_num_neighbors);
+    ser::deserialize(stream, results_.avg_joint_distance);
+  }
+  catch (const ser::StreamOverrunException& ex)
   {
+    ROS_ERROR_STREAM("Reach database file '" << filename << "' is corrupt: " << ex.what());
+    return false;
+  }
+
+  for (Stripe& s : stripes_)
+  {
+    s.dirty.clear();
+  }
+  return true;
+}
+
+bool ReachDatabase::checkpoint(const std::string& filename, const uint64_t n_points, const uint32_t study_checksum)
+{
+  // Serialize checkpoints such that records are appended to the file in the order in which they were collected
+  std::lock_guard<std::mutex> checkpoint_lock{ checkpoint_mutex_ };
+
+  // Start a new checkpoint file with the header of the study
+  std::ifstream existing(filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+  if (!existing || existing.tellg() <= 0)
+  {
+    CheckpointHeader header = {};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.study_checksum = study_checksum;
+    header.n_points = n_points;
+
+    std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)))
+    {
+      return false;
+    }
+  }
+
+  std::vector<reach_msgs::ReachRecord> records;
+  {
+    std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+    for (Stripe& s : stripes_)
+    {
+      std::lock_guard<std::mutex> stripe_lock{ s.mutex };
+      for (const std::size_t index : s.dirty)
+      {
+        records.push_back(records_[index]);
+      }
+      s.dirty.clear();
+    }
+  }
+
+  return reach::utils::appendToFile(filename, records);
+}
+
+bool ReachDatabase::loadCheckpoint(const std::string& filename, const uint64_t n_points, const uint32_t study_checksum)
+{
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+
+  CheckpointHeader header = {};
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+      header.version != CHECKPOINT_VERSION || header.n_points != n_points || header.study_checksum != study_checksum)
+  {
+    ROS_WARN_STREAM("Discarding checkpoint '" << filename << "', which was not written by this reach study");
+    file.close();
+    std::remove(filename.c_str());
+    return false;
+  }
+  file.close();
+
+  std::vector<reach_msgs::ReachRecord> records;
+  std::streamoff end = 0;
+  if (!reach::utils::fromAppendedFile(filename, records, sizeof(header), &end))
+  {
+    return false;
+  }
+
+  // Remove the partial record left by a crash, after which later checkpoints would append records that cannot be read
+  try
+  {
+    if (static_cast<boost::uintmax_t>(end) < boost::filesystem::file_size(filename))
+    {
+      boost::filesystem::resize_file(filename, static_cast<boost::uintmax_t>(end));
+    }
+  }
+  catch (const boost::filesystem::filesystem_error& ex)
+  {
+    ROS_ERROR_STREAM("Failed to truncate checkpoint '" << filename << "': " << ex.what());
+    return false;
+  }
+
+  std::unique_lock<std::shared_timed_mutex> lock{ mutex_ };
+  for (const auto& r : records)
+  {
+    // Records of points outside of the study cannot have been written by it
+    const boost::optional<std::size_t> index = parseIndex(r.id);
+    if (index && *index >= n_points)
+      continue;
     putHelper(r);
-    results_.reach_percentage = msg.reach_percentage;
-    results_.total_pose_score = msg.total_pose_score;
-    results_.norm_total_pose_score = msg.norm_total_pose_score;
-    results_.avg_num_neighbors = msg.avg_num_neighbors;
-    results_.avg_joint_distance = msg.avg_joint_distance;
+  }
+
+  for (Stripe& s : stripes_)
+  {
+    s.dirty.clear();
   }
   return true;
 }
 
 boost::optional<reach_msgs::ReachRecord> ReachDatabase::get(const std::string& id) const
 {
-  std::lock_guard<std::mutex> lock{ mutex_ };
-  auto it = map_.find(id);
-  if (it != map_.end())
+  std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+  const boost::optional<std::size_t> index = findIndex(id);
+  if (index)
   {
-    return { it->second };
+    std::lock_guard<std::mutex> stripe_lock{ stripe(*index).mutex };
+    if (records_[*index].id == id)
+    {
+      return { records_[*index] };
+    }
   }
-  else
+
+  return {};
+}
+
+boost::optional<std::size_t> ReachDatabase::indexOf(const std::string& id) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+  const boost::optional<std::size_t> index = findIndex(id);
+  if (index)
   {
-    return {};
+    std::lock_guard<std::mutex> stripe_lock{ stripe(*index).mutex };
+    if (records_[*index].id == id)
+    {
+      return index;
+    }
   }
+
+  return {};
+}
+
+boost::optional<reach_msgs::ReachRecord> ReachDatabase::get(const std::size_t index) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+  if (index < records_.size())
+  {
+    std::lock_guard<std::mutex> stripe_lock{ stripe(index).mutex };
+    if (!records_[index].id.empty())
+    {
+      return { records_[index] };
+    }
+  }
+
+  return {};
 }
 
 void ReachDatabase::put(const reach_msgs::ReachRecord& record)
 {
-  std::lock_guard<std::mutex> lock{ mutex_ };
-  return putHelper(record);
+  {
+    // Store the record in place if its index already exists and is not taken by a record with a different ID
+    std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+    const boost::optional<std::size_t> index = findIndex(record.id);
+    if (index)
+    {
+      Stripe& s = stripe(*index);
+      std::lock_guard<std::mutex> stripe_lock{ s.mutex };
+      if (records_[*index].id.empty() || records_[*index].id == record.id)
+      {
+        // Rebuild the spatial indices on the next query if a record is added or moved
+        if (records_[*index].id.empty() || !samePose(records_[*index].goal, record.goal))
+        {
+          spatial_index_stale_ = true;
+          oriented_index_stale_ = true;
+        }
+
+        s.remove(records_[*index]);
+        records_[*index] = record;
+        s.add(record);
+        s.dirty.insert(*index);
+        return;
+      }
+    }
+  }
+
+  // Otherwise the layout of the database must change to add the record
+  std::unique_lock<std::shared_timed_mutex> lock{ mutex_ };
+  putHelper(record);
+}
+
+bool ReachDatabase::updateIfBetter(const std::size_t index, const std::vector<double>& seed_position,
+                                   const std::vector<double>& goal_position, const double score)
+{
+  std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+  if (index >= records_.size())
+  {
+    return false;
+  }
+
+  Stripe& s = stripe(index);
+  std::lock_guard<std::mutex> stripe_lock{ s.mutex };
+  reach_msgs::ReachRecord& record = records_[index];
+  if (record.id.empty() || (record.reached && score <= record.score))
+  {
+    return false;
+  }
+
+  s.remove(record);
+  record.reached = true;
+  record.seed_state.position = seed_position;
+  record.goal_state.position = goal_position;
+  record.score = score;
+  s.add(record);
+  s.dirty.insert(index);
+  return true;
+}
+
+boost::optional<std::size_t> ReachDatabase::findIndex(const std::string& id) const
+{
+  auto it = ids_.find(id);
+  if (it != ids_.end())
+  {
+    return it->second;
+  }
+
+  const boost::optional<std::size_t> index = parseIndex(id);
+  if (index && *index < records_.size())
+  {
+    return index;
+  }
+
+  return {};
 }
 
 void ReachDatabase::putHelper(const reach_msgs::ReachRecord& record)
 {
-  map_[record.id] = record;
+  // Replace the record with the same ID, or store the record at the index encoded in its ID, or append it
+  boost::optional<std::size_t> index = findIndex(record.id);
+  if (!index || (!records_[*index].id.empty() && records_[*index].id != record.id))
+  {
+    index = parseIndex(record.id);
+    if (!index || (*index < records_.size() && !records_[*index].id.empty()))
+    {
+      // The ID does not encode an index, or the index is already taken by a record with a different ID
+      index = records_.size();
+      ids_.emplace(record.id, *index);
+    }
+
+    if (*index >= records_.size())
+    {
+      records_.resize(*index + 1);
+    }
+  }
+
+  // Rebuild the spatial indices on the next query if a record is added or moved
+  if (records_[*index].id.empty() || !samePose(records_[*index].goal, record.goal))
+  {
+    spatial_index_stale_ = true;
+    oriented_index_stale_ = true;
+  }
+
+  Stripe& s = stripe(*index);
+  s.remove(records_[*index]);
+  records_[*index] = record;
+  s.add(record);
+  s.dirty.insert(*index);
 }
 
-std::size_t ReachDatabase::size() const
+void ReachDatabase::Stripe::add(const reach_msgs::ReachRecord& record)
+{
+  // Indices that do not contain a record do not contribute to the results
+  if (record.id.empty())
+    return;
+
+  ++n_records;
+  if (record.reached)
+  {
+    ++n_reached;
+    total_score += toFixedPoint(record.score);
+  }
+}
+
+void ReachDatabase::Stripe::remove(const reach_msgs::ReachRecord& record)
 {
-  return map_.size();
+  if (record.id.empty())
+    return;
+
+  --n_records;
+  if (record.reached)
+  {
+    --n_reached;
+    total_score -= toFixedPoint(record.score);
+  }
 }
 
-void ReachDatabase::calculateResults()
+std::vector<std::size_t> ReachDatabase::radiusSearch(const geometry_msgs::Point& position, const double radius) const
 {
-  unsigned int success = 0, total = 0;
-  double score = 0.0;
-  for (int i = 0; i < this->size(); ++i)
+  std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+  const SpatialIndexPtr index = getSpatialIndex(lock);
+
+  std::vector<std::size_t> indices;
+  index->radiusSearch(Eigen::Vector3f(position.x, position.y, position.z), radius, indices);
+  for (std::size_t& i : indices)
   {
-    reach_msgs::ReachRecord msg = *this->get(std::to_string(i));
+    i = spatial_index_records_[i];
+  }
+  return indices;
+}
 
-    if (msg.reached)
+std::vector<std::size_t> ReachDatabase::nearestKSearch(const geometry_msgs::Point& position, const std::size_t k) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+  const SpatialIndexPtr index = getSpatialIndex(lock);
+
+  std::vector<std::size_t> indices;
+  index->nearestKSearch(Eigen::Vector3f(position.x, position.y, position.z), k, indices);
+  for (std::size_t& i : indices)
+  {
+    i = spatial_index_records_[i];
+  }
+  return indices;
+}
+
+std::vector<std::size_t> ReachDatabase::radiusSearch(const geometry_msgs::Pose& pose, const double radius,
+                                                     const double max_angle) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+  const OrientedSpatialIndexPtr index = getOrientedIndex(lock);
+
+  std::vector<std::size_t> indices;
+  index->radiusSearch(Eigen::Vector3f(pose.position.x, pose.position.y, pose.position.z), goalDirection(pose), radius,
+                      max_angle, indices);
+  for (std::size_t& i : indices)
+  {
+    i = oriented_index_records_[i];
+  }
+  return indices;
+}
+
+void ReachDatabase::setSpatialIndexFactory(const SpatialIndexFactory& factory)
+{
+  std::unique_lock<std::shared_timed_mutex> lock{ mutex_ };
+  spatial_index_factory_ = factory;
+  spatial_index_stale_ = true;
+  oriented_index_stale_ = true;
+}
+
+SpatialIndexPtr ReachDatabase::getSpatialIndex(std::shared_lock<std::shared_timed_mutex>& lock) const
+{
+  while (spatial_index_stale_)
+  {
+    // Build the index under an exclusive lock, unless another thread builds it first
+    lock.unlock();
     {
-      success++;
-      score += msg.score;
+      std::unique_lock<std::shared_timed_mutex> unique_lock{ mutex_ };
+      if (spatial_index_stale_)
+      {
+        std::vector<Eigen::Vector3f> points;
+        spatial_index_records_.clear();
+        for (std::size_t i = 0; i < records_.size(); ++i)
+        {
+          if (records_[i].id.empty())
+            continue;
+
+          const geometry_msgs::Point& p = records_[i].goal.position;
+          points.emplace_back(p.x, p.y, p.z);
+          spatial_index_records_.push_back(i);
+        }
+
+        const SpatialIndexPtr index = spatial_index_factory_(points.size());
+        index->build(points);
+        spatial_index_ = index;
+        spatial_index_stale_ = false;
+      }
+    }
+    lock.lock();
+  }
+
+  return spatial_index_;
+}
+
+OrientedSpatialIndexPtr ReachDatabase::getOrientedIndex(std::shared_lock<std::shared_timed_mutex>& lock) const
+{
+  while (oriented_index_stale_)
+  {
+    // Build the index under an exclusive lock, unless another thread builds it first
+    lock.unlock();
+    {
+      std::unique_lock<std::shared_timed_mutex> unique_lock{ mutex_ };
+      if (oriented_index_stale_)
+      {
+        std::vector<Eigen::Vector3f> points, directions;
+        oriented_index_records_.clear();
+        for (std::size_t i = 0; i < records_.size(); ++i)
+        {
+          if (records_[i].id.empty())
+            continue;
+
+          const geometry_msgs::Point& p = records_[i].goal.position;
+          points.emplace_back(p.x, p.y, p.z);
+          directions.push_back(goalDirection(records_[i].goal));
+          oriented_index_records_.push_back(i);
+        }
+
+        auto index = std::make_shared<OrientedSpatialIndex>(spatial_index_factory_);
+        index->build(points, directions);
+        oriented_index_ = index;
+        oriented_index_stale_ = false;
+      }
     }
+    lock.lock();
+  }
+
+  return oriented_index_;
+}
 
-    total++;
+std::size_t ReachDatabase::size() const
+{
+  std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+  return records_.size();
+}
+
+StudyResults ReachDatabase::getStudyResults() const
+{
+  std::shared_lock<std::shared_timed_mutex> lock{ mutex_ };
+  return getStudyResultsHelper();
+}
+
+StudyResults ReachDatabase::getStudyResultsHelper() const
+{
+  std::size_t success = 0, total = 0;
+  int64_t fixed_score = 0;
+  for (Stripe& s : stripes_)
+  {
+    std::lock_guard<std::mutex> stripe_lock{ s.mutex };
+    success += s.n_reached;
+    total += s.n_records;
+    fixed_score += s.total_score;
   }
-  const float pct_success = static_cast<float>(success) / static_cast<float>(total);
+  const double score = static_cast<double>(fixed_score) * SCORE_RESOLUTION;
 
-  results_.reach_percentage = 100.0f * pct_success;
-  results_.total_pose_score = score;
-  results_.norm_total_pose_score = score / pct_success;
+  StudyResults results = results_;
+  results.total_pose_score = score;
+  if (success > 0)
+  {
+    const float pct_success = static_cast<float>(success) / static_cast<float>(total);
+    results.reach_percentage = 100.0f * pct_success;
+    results.norm_total_pose_score = score / pct_success;
+  }
+  else
+  {
+    results.reach_percentage = 0.0f;
+    results.norm_total_pose_score = 0.0f;
+  }
+  return results;
 }
 
 void ReachDatabase::printResults()
 {
+  const StudyResults results = getStudyResults();
   ROS_INFO("------------------------------------------------");
-  ROS_INFO_STREAM("Percent Reached = " << results_.reach_percentage);
-  ROS_INFO_STREAM("Total points score = " << results_.total_pose_score);
-  ROS_INFO_STREAM("Normalized total points score = " << results_.norm_total_pose_score);
-  ROS_INFO_STREAM("Average reachable neighbors = " << results_.avg_num_neighbors);
-  ROS_INFO_STREAM("Average joint distance = " << results_.avg_joint_distance);
+  ROS_INFO_STREAM("Percent Reached = " << results.reach_percentage);
+  ROS_INFO_STREAM("Total points score = " << results.total_pose_score);
+  ROS_INFO_STREAM("Normalized total points score = " << results.norm_total_pose_score);
+  ROS_INFO_STREAM("Average reachable neighbors = " << results.avg_num_neighbors);
+  ROS_INFO_STREAM("Average joint distance = " << results.avg_joint_distance);
   ROS_INFO_STREAM("------------------------------------------------");
 }
 
 reach_msgs::ReachDatabase ReachDatabase::toReachDatabaseMsg()
 {
-  return toReachDatabase(map_, results_);
+  std::unique_lock<std::shared_timed_mutex> lock{ mutex_ };
+  return toReachDatabase(records_, getStudyResultsHelper());
 }
 
 }  // namespace core
@@ -0,0 +1,979 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <reach_core/reach_database_file.h>
+
+#include <ros/console.h>
+
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+const char MAGIC[8] = { 'R', 'E', 'A', 'C', 'H', 'D', 'B', '\0' };
+const uint32_t FORMAT_VERSION = 3;
+
+// Alignment (in bytes) of the start of each column in the file
+const std::size_t COLUMN_ALIGNMENT = 64;
+
+// Size (in bytes) of the chunks in which columns are written and checksummed
+const std::size_t CHUNK_SIZE = 1 << 20;
+
+// Number of records per block of the compact encoding
+const std::size_t BLOCK_SIZE = 64;
+
+// Quantization step of the joint positions of the compact encoding
+const double JOINT_RESOLUTION = 1.0e-6;
+
+enum Column : uint32_t
+{
+  PRESENT = 0,
+  REACHED,
+  POSITIONS,
+  ORIENTATIONS,
+  SCORES,
+  SEED_POSITIONS,
+  GOAL_POSITIONS,
+  ID_OFFSETS,
+  ID_CHARS,
+  JOINT_NAMES,
+  // Checksums of the chunks of all of the preceding columns (since version 2)
+  CHECKSUMS,
+  N_COLUMNS
+};
+
+// Number of columns of version 1 files, which did not contain checksums
+const uint32_t N_COLUMNS_V1 = CHECKSUMS;
+
+enum Encoding : uint32_t
+{
+  RAW = 0,
+  COMPACT = 1
+};
+
+struct ColumnEntry
+{
+  uint64_t offset;
+  uint64_t size;
+};
+
+/**
+ * @brief Header at the start of a columnar reach database file. All values are stored in the native byte order
+ */
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t n_columns;
+  uint64_t n_records;
+  uint64_t n_joints;
+  float total_pose_score;
+  float norm_total_pose_score;
+  float reach_percentage;
+  float avg_num_neighbors;
+  float avg_joint_distance;
+  // Size of the checksummed chunks of the columns (since version 2)
+  uint32_t chunk_size;
+  ColumnEntry columns[N_COLUMNS];
+  // Encoding of the columns (since version 3)
+  uint32_t encoding;
+  uint32_t reserved;
+};
+
+/**
+ * @brief Returns the size of the header of a file of the input version
+ */
+std::size_t headerSize(const uint32_t version)
+{
+  switch (version)
+  {
+    case 1:
+      return offsetof(FileHeader, columns) + N_COLUMNS_V1 * sizeof(ColumnEntry);
+    case 2:
+      return offsetof(FileHeader, encoding);
+    default:
+      return sizeof(FileHeader);
+  }
+}
+
+uint32_t checksum(const void* data, const std::size_t size)
+{
+  boost::crc_32_type crc;
+  crc.process_bytes(data, size);
+  return crc.checksum();
+}
+
+int64_t quantize(const double value)
+{
+  return std::llround(value / JOINT_RESOLUTION);
+}
+
+uint64_t zigzag(const int64_t value)
+{
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(const uint64_t value)
+{
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void appendVarint(std::vector<uint8_t>& bytes, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    bytes.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  bytes.push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * @brief Reads a variable-length integer and advances the input pointer past it
+ * @return false if the integer extends past the end of the data
+ */
+bool readVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value)
+{
+  value = 0;
+  for (unsigned shift = 0; data < end && shift < 64; shift += 7)
+  {
+    const uint8_t byte = *data++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Checks that a column of joint positions of the compact encoding can be decoded: the offsets of the blocks
+ * must start at zero and lie within the column, and each block must consist of exactly the variable-length integers of
+ * the joint positions of its records, with values that the writer can have produced
+ * @param column
+ * @param size size of the column in bytes, including the block offsets at its end
+ * @param n_records
+ * @param n_joints
+ * @param max_value maximum magnitude of the (zigzag decoded) integers
+ * @return
+ */
+bool isValidJointColumn(const char* column, const std::size_t size, const std::size_t n_records,
+                        const std::size_t n_joints, const uint64_t max_value)
+{
+  const std::size_t n_blocks = (n_records + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  const std::size_t data_size = size - n_blocks * sizeof(uint64_t);
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(column);
+
+  std::size_t end = 0;
+  for (std::size_t block = 0; block < n_blocks; ++block)
+  {
+    uint64_t offset;
+    std::memcpy(&offset, column + data_size + block * sizeof(uint64_t), sizeof(offset));
+    if (offset != end)
+      return false;
+
+    const uint8_t* value = data + offset;
+    const std::size_t n_values = std::min(BLOCK_SIZE, n_records - block * BLOCK_SIZE) * n_joints;
+    for (std::size_t i = 0; i < n_values; ++i)
+    {
+      uint64_t encoded;
+      if (!readVarint(value, data + data_size, encoded))
+        return false;
+
+      const int64_t decoded = unzigzag(encoded);
+      if (decoded > static_cast<int64_t>(max_value) || decoded < -static_cast<int64_t>(max_value))
+        return false;
+    }
+    end = static_cast<std::size_t>(value - data);
+  }
+
+  // Only the padding that aligns the block offsets may follow the last block
+  return data_size - end < sizeof(uint64_t);
+}
+
+template <typename T>
+T readValue(const char* data, const std::size_t index)
+{
+  T value;
+  std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+  return value;
+}
+
+/**
+ * @brief Checks whether the score and joint positions of a record can be represented by the compact encoding
+ */
+bool isCompactable(const reach_msgs::ReachRecord& record)
+{
+  // Quantized joint positions must fit comfortably in 64-bit integers
+  auto is_valid_joint = [](const double value) { return std::isfinite(value) && std::abs(value) < 1.0e9; };
+  return std::isfinite(record.score) &&
+         std::all_of(record.seed_state.position.begin(), record.seed_state.position.end(), is_valid_joint) &&
+         std::all_of(record.goal_state.position.begin(), record.goal_state.position.end(), is_valid_joint);
+}
+
+/**
+ * @brief Writes the values of one column to the end of a file in fixed-size chunks, and records the checksum of each
+ * chunk
+ */
+class ColumnWriter
+{
+public:
+  ColumnWriter(std::ofstream& file, ColumnEntry& column, std::vector<uint32_t>* checksums)
+    : file_(file), column_(column), checksums_(checksums)
+  {
+    // Pad the file such that the column starts on an aligned offset
+    static const char zeros[COLUMN_ALIGNMENT] = {};
+    const std::size_t pos = static_cast<std::size_t>(file_.tellp());
+    const std::size_t padding = (COLUMN_ALIGNMENT - pos % COLUMN_ALIGNMENT) % COLUMN_ALIGNMENT;
+    file_.write(zeros, padding);
+
+    column_.offset = pos + padding;
+    column_.size = 0;
+    buffer_.reserve(CHUNK_SIZE);
+  }
+
+  template <typename T>
+  void write(const T* values, const std::size_t n)
+  {
+    const char* bytes = reinterpret_cast<const char*>(values);
+    std::size_t remaining = n * sizeof(T);
+    while (remaining > 0)
+    {
+      const std::size_t count = std::min(remaining, CHUNK_SIZE - buffer_.size());
+      buffer_.insert(buffer_.end(), bytes, bytes + count);
+      bytes += count;
+      remaining -= count;
+
+      if (buffer_.size() == CHUNK_SIZE)
+      {
+        flush();
+      }
+    }
+  }
+
+  template <typename T>
+  void write(const T& value)
+  {
+    write(&value, 1);
+  }
+
+  /**
+   * @brief Returns the number of bytes written to the column so far
+   */
+  std::size_t size() const
+  {
+    return column_.size + buffer_.size();
+  }
+
+  /**
+   * @brief Writes the buffered chunk to the file. Only the final chunk of a column may be smaller than the chunk size
+   */
+  void flush()
+  {
+    if (buffer_.empty())
+      return;
+
+    file_.write(buffer_.data(), buffer_.size());
+    column_.size += buffer_.size();
+    if (checksums_)
+    {
+      checksums_->push_back(checksum(buffer_.data(), buffer_.size()));
+    }
+    buffer_.clear();
+  }
+
+private:
+  std::ofstream& file_;
+  ColumnEntry& column_;
+  std::vector<uint32_t>* checksums_;
+  std::vector<char> buffer_;
+};
+
+/**
+ * @brief Writes a column of bits, one per record, packed into 64-bit words
+ */
+template <typename Predicate>
+void writeBits(std::ofstream& file, ColumnEntry& column, std::vector<uint32_t>& checksums,
+               const std::vector<reach_msgs::ReachRecord>& records, Predicate predicate)
+{
+  ColumnWriter writer(file, column, &checksums);
+  uint64_t word = 0;
+  for (std::size_t i = 0; i < records.size(); ++i)
+  {
+    if (predicate(records[i]))
+    {
+      word |= uint64_t(1) << (i % 64);
+    }
+
+    if (i % 64 == 63)
+    {
+      writer.write(word);
+      word = 0;
+    }
+  }
+
+  if (records.size() % 64 != 0)
+  {
+    writer.write(word);
+  }
+  writer.flush();
+}
+
+/**
+ * @brief Writes a column of joint positions in the compact encoding. The joint positions of each record are quantized
+ * and written as variable-length integers relative to the (quantized) reference joint positions of the record, if any.
+ * The column ends with the offsets of the start of each block of records, such that blocks can be decoded
+ * independently
+ */
+template <typename Positions, typename Reference>
+void writeCompactJoints(std::ofstream& file, ColumnEntry& column, std::vector<uint32_t>& checksums,
+                        const std::vector<reach_msgs::ReachRecord>& records, const std::size_t n_joints,
+                        Positions positions, Reference reference)
+{
+  ColumnWriter writer(file, column, &checksums);
+  std::vector<uint64_t> block_offsets;
+  block_offsets.reserve((records.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+
+  std::vector<uint8_t> bytes;
+  for (std::size_t i = 0; i < records.size(); ++i)
+  {
+    if (i % BLOCK_SIZE == 0)
+    {
+      block_offsets.push_back(writer.size());
+    }
+
+    // Entries that do not contain a record are encoded as zeros
+    bytes.clear();
+    const reach_msgs::ReachRecord& r = records[i];
+    for (std::size_t j = 0; j < n_joints; ++j)
+    {
+      const int64_t value = r.id.empty() ? 0 : quantize(positions(r)[j]) - reference(r, j);
+      appendVarint(bytes, zigzag(value));
+    }
+    writer.write(bytes.data(), bytes.size());
+  }
+
+  const uint8_t padding[sizeof(uint64_t)] = {};
+  writer.write(padding, (sizeof(uint64_t) - writer.size() % sizeof(uint64_t)) % sizeof(uint64_t));
+  writer.write(block_offsets.data(), block_offsets.size());
+  writer.flush();
+}
+
+}  // namespace
+
+namespace reach
+{
+namespace core
+{
+bool isColumnarDatabaseFile(const std::string& filename)
+{
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  char magic[sizeof(MAGIC)];
+  return file.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool haveCommonJoints(const std::vector<reach_msgs::ReachRecord>& records)
+{
+  auto is_present = [](const reach_msgs::ReachRecord& r) { return !r.id.empty(); };
+  auto first = std::find_if(records.begin(), records.end(), is_present);
+  if (first == records.end())
+  {
+    return true;
+  }
+
+  const std::vector<std::string>& joint_names = first->seed_state.name;
+  const std::size_t n_joints = joint_names.size();
+  return std::all_of(records.begin(), records.end(), [&](const reach_msgs::ReachRecord& r) {
+    return !is_present(r) || (r.seed_state.name == joint_names && r.goal_state.name == joint_names &&
+                              r.seed_state.position.size() == n_joints && r.goal_state.position.size() == n_joints);
+  });
+}
+
+bool writeColumnarDatabaseFile(const std::string& filename, const std::vector<reach_msgs::ReachRecord>& records,
+                               const StudyResults& results, bool compact)
+{
+  auto is_present = [](const reach_msgs::ReachRecord& r) { return !r.id.empty(); };
+
+  // Make sure all records share the same joints, such that the joint names only need to be stored once
+  if (!haveCommonJoints(records))
+  {
+    return false;
+  }
+
+  std::vector<std::string> joint_names;
+  auto first = std::find_if(records.begin(), records.end(), is_present);
+  if (first != records.end())
+  {
+    joint_names = first->seed_state.name;
+  }
+  const std::size_t n_joints = joint_names.size();
+
+  if (compact && !std::all_of(records.begin(), records.end(), isCompactable))
+  {
+    ROS_WARN_STREAM("Records contain values that cannot be compacted; writing '" << filename << "' uncompacted");
+    compact = false;
+  }
+
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    return false;
+  }
+
+  FileHeader header = {};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = FORMAT_VERSION;
+  header.n_columns = N_COLUMNS;
+  header.n_records = records.size();
+  header.n_joints = n_joints;
+  header.total_pose_score = results.total_pose_score;
+  header.norm_total_pose_score = results.norm_total_pose_score;
+  header.reach_percentage = results.reach_percentage;
+  header.avg_num_neighbors = results.avg_num_neighbors;
+  header.avg_joint_distance = results.avg_joint_distance;
+  header.chunk_size = CHUNK_SIZE;
+  header.encoding = compact ? COMPACT : RAW;
+
+  // Reserve space for the header, which is written once the column locations are known
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  std::vector<uint32_t> checksums;
+  writeBits(file, header.columns[PRESENT], checksums, records, is_present);
+  writeBits(file, header.columns[REACHED], checksums, records,
+            [](const reach_msgs::ReachRecord& r) { return r.reached; });
+
+  {
+    ColumnWriter writer(file, header.columns[POSITIONS], &checksums);
+    for (const reach_msgs::ReachRecord& r : records)
+    {
+      const double position[3] = { r.goal.position.x, r.goal.position.y, r.goal.position.z };
+      if (compact)
+      {
+        const float position_f[3] = { float(position[0]), float(position[1]), float(position[2]) };
+        writer.write(position_f, 3);
+      }
+      else
+      {
+        writer.write(position, 3);
+      }
+    }
+    writer.flush();
+  }
+
+  {
+    ColumnWriter writer(file, header.columns[ORIENTATIONS], &checksums);
+    for (const reach_msgs::ReachRecord& r : records)
+    {
+      const double orientation[4] = { r.goal.orientation.x, r.goal.orientation.y, r.goal.orientation.z,
+                                      r.goal.orientation.w };
+      if (compact)
+      {
+        const float orientation_f[4] = { float(orientation[0]), float(orientation[1]), float(orientation[2]),
+                                         float(orientation[3]) };
+        writer.write(orientation_f, 4);
+      }
+      else
+      {
+        writer.write(orientation, 4);
+      }
+    }
+    writer.flush();
+  }
+
+  if (compact)
+  {
+    // Each block of records stores an exponent shared by the 32-bit mantissas of the scores of the block
+    ColumnWriter writer(file, header.columns[SCORES], &checksums);
+    for (std::size_t begin = 0; begin < records.size(); begin += BLOCK_SIZE)
+    {
+      const std::size_t end = std::min(begin + BLOCK_SIZE, records.size());
+
+      double max_score = 0.0;
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        max_score = std::max(max_score, std::abs(records[i].score));
+      }
+
+      int exponent = 0;
+      std::frexp(max_score, &exponent);
+      writer.write(static_cast<int32_t>(exponent));
+
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        const long long mantissa = std::llround(std::ldexp(records[i].score, 31 - exponent));
+        writer.write(static_cast<int32_t>(std::max<long long>(std::min<long long>(mantissa, INT32_MAX), -INT32_MAX)));
+      }
+    }
+    writer.flush();
+  }
+  else
+  {
+    ColumnWriter writer(file, header.columns[SCORES], &checksums);
+    for (const reach_msgs::ReachRecord& r : records)
+    {
+      writer.write(r.score);
+    }
+    writer.flush();
+  }
+
+  if (compact)
+  {
+    // Seed positions are encoded as is, and goal positions relative to the seed positions
+    auto seed = [](const reach_msgs::ReachRecord& r) -> const std::vector<double>& { return r.seed_state.position; };
+    auto goal = [](const reach_msgs::ReachRecord& r) -> const std::vector<double>& { return r.goal_state.position; };
+    auto zero = [](const reach_msgs::ReachRecord&, const std::size_t) { return int64_t(0); };
+    auto seed_reference = [](const reach_msgs::ReachRecord& r, const std::size_t j) {
+      return quantize(r.seed_state.position[j]);
+    };
+    writeCompactJoints(file, header.columns[SEED_POSITIONS], checksums, records, n_joints, seed, zero);
+    writeCompactJoints(file, header.columns[GOAL_POSITIONS], checksums, records, n_joints, goal, seed_reference);
+  }
+  else
+  {
+    // Entries that do not contain a record are filled with zeros
+    const std::vector<double> zeros(n_joints, 0.0);
+    {
+      ColumnWriter writer(file, header.columns[SEED_POSITIONS], &checksums);
+      for (const reach_msgs::ReachRecord& r : records)
+      {
+        writer.write(is_present(r) ? r.seed_state.position.data() : zeros.data(), n_joints);
+      }
+      writer.flush();
+    }
+
+    {
+      ColumnWriter writer(file, header.columns[GOAL_POSITIONS], &checksums);
+      for (const reach_msgs::ReachRecord& r : records)
+      {
+        writer.write(is_present(r) ? r.goal_state.position.data() : zeros.data(), n_joints);
+      }
+      writer.flush();
+    }
+  }
+
+  // The IDs are stored as a list of offsets into the concatenation of all IDs
+  {
+    ColumnWriter writer(file, header.columns[ID_OFFSETS], &checksums);
+    uint64_t offset = 0;
+    writer.write(offset);
+    for (const reach_msgs::ReachRecord& r : records)
+    {
+      offset += r.id.size();
+      writer.write(offset);
+    }
+    writer.flush();
+  }
+
+  {
+    ColumnWriter writer(file, header.columns[ID_CHARS], &checksums);
+    for (const reach_msgs::ReachRecord& r : records)
+    {
+      writer.write(r.id.data(), r.id.size());
+    }
+    writer.flush();
+  }
+
+  {
+    ColumnWriter writer(file, header.columns[JOINT_NAMES], &checksums);
+    for (const std::string& name : joint_names)
+    {
+      writer.write(name.c_str(), name.size() + 1);
+    }
+    writer.flush();
+  }
+
+  {
+    ColumnWriter writer(file, header.columns[CHECKSUMS], nullptr);
+    writer.write(checksums.data(), checksums.size());
+    writer.flush();
+  }
+
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.flush();
+  return file.good();
+}
+
+bool MappedReachDatabase::open(const std::string& filename)
+{
+  close();
+
+  if (!file_.open(filename) || file_.size() < offsetof(FileHeader, n_columns))
+  {
+    close();
+    return false;
+  }
+
+  FileHeader header = {};
+  std::memcpy(&header, file_.data(), offsetof(FileHeader, n_columns));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+  {
+    close();
+    return false;
+  }
+
+  if (header.version < 1 || header.version > FORMAT_VERSION)
+  {
+    ROS_ERROR_STREAM("Unsupported reach database file version " << header.version << " in '" << filename << "'");
+    close();
+    return false;
+  }
+
+  // Older headers are prefixes of the current header
+  const std::size_t file_size = file_.size();
+  const std::size_t header_size = headerSize(header.version);
+  const uint32_t n_columns = header.version == 1 ? N_COLUMNS_V1 : N_COLUMNS;
+  if (file_size < header_size)
+  {
+    ROS_ERROR_STREAM("Reach database file '" << filename << "' is corrupt");
+    close();
+    return false;
+  }
+  std::memcpy(&header, file_.data(), header_size);
+
+  // Every entry occupies at least one byte, which bounds the sizes used below
+  if (header.n_columns != n_columns || header.encoding > COMPACT || header.n_records > file_size ||
+      (header.n_records > 0 && header.n_joints > file_size / header.n_records))
+  {
+    ROS_ERROR_STREAM("Reach database file '" << filename << "' is corrupt");
+    close();
+    return false;
+  }
+
+  compact_ = header.encoding == COMPACT;
+  n_records_ = header.n_records;
+  n_joints_ = header.n_joints;
+  chunk_size_ = header.chunk_size;
+
+  // The checksum column contains one checksum for every chunk of every other column
+  uint64_t n_chunks = 0;
+  if (n_columns > CHECKSUMS)
+  {
+    if (chunk_size_ == 0)
+    {
+      ROS_ERROR_STREAM("Reach database file '" << filename << "' is corrupt");
+      close();
+      return false;
+    }
+
+    for (uint32_t c = 0; c < CHECKSUMS; ++c)
+    {
+      n_chunks += (header.columns[c].size + chunk_size_ - 1) / chunk_size_;
+    }
+  }
+
+  const uint64_t n_words = (n_records_ + 63) / 64;
+  const uint64_t n_blocks = (n_records_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  const std::size_t real_size = compact_ ? sizeof(float) : sizeof(double);
+  uint64_t expected_sizes[N_COLUMNS] = {
+    n_words * sizeof(uint64_t),
+    n_words * sizeof(uint64_t),
+    3 * n_records_ * real_size,
+    4 * n_records_ * real_size,
+    n_records_ * sizeof(double),
+    n_joints_ * n_records_ * sizeof(double),
+    n_joints_ * n_records_ * sizeof(double),
+    (n_records_ + 1) * sizeof(uint64_t),
+    header.columns[ID_CHARS].size,
+    header.columns[JOINT_NAMES].size,
+    n_chunks * sizeof(uint32_t),
+  };
+
+  if (compact_)
+  {
+    expected_sizes[SCORES] = n_blocks * sizeof(int32_t) + n_records_ * sizeof(int32_t);
+
+    // The joint positions are variable-length, but end with the block offsets
+    for (const Column c : { SEED_POSITIONS, GOAL_POSITIONS })
+    {
+      if (header.columns[c].size < n_blocks * sizeof(uint64_t))
+      {
+        ROS_ERROR_STREAM("Reach database file '" << filename << "' is corrupt");
+        close();
+        return false;
+      }
+      expected_sizes[c] = header.columns[c].size;
+    }
+  }
+
+  for (uint32_t c = 0; c < n_columns; ++c)
+  {
+    const ColumnEntry& column = header.columns[c];
+    if (column.offset % sizeof(uint64_t) != 0 || column.offset > file_size || column.size > file_size - column.offset ||
+        column.size != expected_sizes[c])
+    {
+      ROS_ERROR_STREAM("Reach database file '" << filename << "' is corrupt");
+      close();
+      return false;
+    }
+
+    if (c < CHECKSUMS)
+    {
+      columns_.emplace_back(column.offset, column.size);
+    }
+  }
+
+  const char* data = reinterpret_cast<const char*>(file_.data());
+  present_ = reinterpret_cast<const uint64_t*>(data + header.columns[PRESENT].offset);
+  reached_ = reinterpret_cast<const uint64_t*>(data + header.columns[REACHED].offset);
+  positions_ = data + header.columns[POSITIONS].offset;
+  orientations_ = data + header.columns[ORIENTATIONS].offset;
+  scores_ = data + header.columns[SCORES].offset;
+  seed_positions_ = data + header.columns[SEED_POSITIONS].offset;
+  seed_positions_size_ = header.columns[SEED_POSITIONS].size;
+  goal_positions_ = data + header.columns[GOAL_POSITIONS].offset;
+  goal_positions_size_ = header.columns[GOAL_POSITIONS].size;
+  id_offsets_ = reinterpret_cast<const uint64_t*>(data + header.columns[ID_OFFSETS].offset);
+  id_chars_ = data + header.columns[ID_CHARS].offset;
+  id_chars_size_ = header.columns[ID_CHARS].size;
+  if (n_columns > CHECKSUMS)
+  {
+    checksums_ = reinterpret_cast<const uint32_t*>(data + header.columns[CHECKSUMS].offset);
+  }
+
+  // Joint names are stored as consecutive null-terminated strings
+  const char* names = data + header.columns[JOINT_NAMES].offset;
+  const char* names_end = names + header.columns[JOINT_NAMES].size;
+  while (names < names_end)
+  {
+    const char* name_end = std::find(names, names_end, '\0');
+    joint_names_.emplace_back(names, name_end);
+    names = name_end + 1;
+  }
+
+  if (joint_names_.size() != n_joints_)
+  {
+    ROS_ERROR_STREAM("Reach database file '" << filename << "' is corrupt");
+    close();
+    return false;
+  }
+
+  results_.total_pose_score = header.total_pose_score;
+  results_.norm_total_pose_score = header.norm_total_pose_score;
+  results_.reach_percentage = header.reach_percentage;
+  results_.avg_num_neighbors = header.avg_num_neighbors;
+  results_.avg_joint_distance = header.avg_joint_distance;
+
+  return true;
+}
+
+void MappedReachDatabase::close()
+{
+  file_.close();
+  columns_.clear();
+  chunk_size_ = 0;
+  checksums_ = nullptr;
+  compact_ = false;
+  n_records_ = 0;
+  n_joints_ = 0;
+  results_ = StudyResults();
+  joint_names_.clear();
+  cached_block_ = SIZE_MAX;
+}
+
+bool MappedReachDatabase::verify() const
+{
+  if (checksums_)
+  {
+    std::size_t chunk = 0;
+    for (std::size_t c = 0; c < columns_.size(); ++c)
+    {
+      const uint8_t* column = file_.data() + columns_[c].first;
+      const std::size_t size = columns_[c].second;
+      for (std::size_t offset = 0; offset < size; offset += chunk_size_, ++chunk)
+      {
+        if (checksum(column + offset, std::min(chunk_size_, size - offset)) != checksums_[chunk])
+        {
+          ROS_ERROR_STREAM("Checksum mismatch in chunk " << offset / chunk_size_ << " of column " << c);
+          return false;
+        }
+      }
+    }
+  }
+
+  // The checksums only detect changes made after the file was written, so the offsets into the variable-length columns
+  // are validated as well, such that the accessors never read outside of the columns
+  if (id_offsets_[0] != 0 || id_offsets_[n_records_] != id_chars_size_)
+  {
+    ROS_ERROR("Invalid record ID offsets");
+    return false;
+  }
+  for (std::size_t i = 0; i < n_records_; ++i)
+  {
+    if (id_offsets_[i] > id_offsets_[i + 1])
+    {
+      ROS_ERROR_STREAM("Invalid ID offset of record " << i);
+      return false;
+    }
+  }
+
+  if (compact_)
+  {
+    // Quantized joint positions are less than 1e9 / JOINT_RESOLUTION in magnitude, and goal positions are stored as
+    // differences from the seed positions
+    const uint64_t max_joint = static_cast<uint64_t>(1.0e9 / JOINT_RESOLUTION);
+    if (!isValidJointColumn(seed_positions_, seed_positions_size_, n_records_, n_joints_, max_joint))
+    {
+      ROS_ERROR("Invalid blocks of seed joint positions");
+      return false;
+    }
+    if (!isValidJointColumn(goal_positions_, goal_positions_size_, n_records_, n_joints_, 2 * max_joint))
+    {
+      ROS_ERROR("Invalid blocks of goal joint positions");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+double MappedReachDatabase::score(const std::size_t index) const
+{
+  if (!compact_)
+  {
+    return readValue<double>(scores_, index);
+  }
+
+  const char* block = scores_ + (index / BLOCK_SIZE) * (BLOCK_SIZE + 1) * sizeof(int32_t);
+  const int32_t exponent = readValue<int32_t>(block, 0);
+  const int32_t mantissa = readValue<int32_t>(block, 1 + index % BLOCK_SIZE);
+  return std::ldexp(static_cast<double>(mantissa), exponent - 31);
+}
+
+geometry_msgs::Pose MappedReachDatabase::goal(const std::size_t index) const
+{
+  double p[3], q[4];
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    p[i] = compact_ ? readValue<float>(positions_, 3 * index + i) : readValue<double>(positions_, 3 * index + i);
+  }
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    q[i] = compact_ ? readValue<float>(orientations_, 4 * index + i) : readValue<double>(orientations_, 4 * index + i);
+  }
+
+  geometry_msgs::Pose pose;
+  pose.position.x = p[0];
+  pose.position.y = p[1];
+  pose.position.z = p[2];
+  pose.orientation.x = q[0];
+  pose.orientation.y = q[1];
+  pose.orientation.z = q[2];
+  pose.orientation.w = q[3];
+  return pose;
+}
+
+std::vector<double> MappedReachDatabase::seedPosition(const std::size_t index) const
+{
+  if (!compact_)
+  {
+    const double* begin = reinterpret_cast<const double*>(seed_positions_) + n_joints_ * index;
+    return std::vector<double>(begin, begin + n_joints_);
+  }
+
+  decodeJointBlock(index);
+  auto begin = cached_seed_positions_.begin() + n_joints_ * (index % BLOCK_SIZE);
+  return std::vector<double>(begin, begin + n_joints_);
+}
+
+std::vector<double> MappedReachDatabase::goalPosition(const std::size_t index) const
+{
+  if (!compact_)
+  {
+    const double* begin = reinterpret_cast<const double*>(goal_positions_) + n_joints_ * index;
+    return std::vector<double>(begin, begin + n_joints_);
+  }
+
+  decodeJointBlock(index);
+  auto begin = cached_goal_positions_.begin() + n_joints_ * (index % BLOCK_SIZE);
+  return std::vector<double>(begin, begin + n_joints_);
+}
+
+void MappedReachDatabase::decodeJointBlock(const std::size_t index) const
+{
+  const std::size_t block = index / BLOCK_SIZE;
+  if (block == cached_block_)
+    return;
+
+  const std::size_t n_blocks = (n_records_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  const std::size_t n_values = std::min(BLOCK_SIZE, n_records_ - block * BLOCK_SIZE) * n_joints_;
+  cached_seed_positions_.assign(n_values, 0.0);
+  cached_goal_positions_.assign(n_values, 0.0);
+  cached_block_ = block;
+
+  // Each column of joint positions ends with the offsets of its blocks
+  const std::size_t seed_size = seed_positions_size_ - n_blocks * sizeof(uint64_t);
+  const std::size_t goal_size = goal_positions_size_ - n_blocks * sizeof(uint64_t);
+  const uint64_t seed_offset = readValue<uint64_t>(seed_positions_ + seed_size, block);
+  const uint64_t goal_offset = readValue<uint64_t>(goal_positions_ + goal_size, block);
+  if (seed_offset > seed_size || goal_offset > goal_size)
+  {
+    ROS_ERROR_STREAM("Invalid joint position offsets for block " << block);
+    return;
+  }
+
+  const uint8_t* seed = reinterpret_cast<const uint8_t*>(seed_positions_) + seed_offset;
+  const uint8_t* seed_end = reinterpret_cast<const uint8_t*>(seed_positions_) + seed_size;
+  const uint8_t* goal = reinterpret_cast<const uint8_t*>(goal_positions_) + goal_offset;
+  const uint8_t* goal_end = reinterpret_cast<const uint8_t*>(goal_positions_) + goal_size;
+  for (std::size_t i = 0; i < n_values; ++i)
+  {
+    uint64_t seed_value, goal_delta;
+    if (!readVarint(seed, seed_end, seed_value) || !readVarint(goal, goal_end, goal_delta))
+    {
+      ROS_ERROR_STREAM("Truncated joint positions in block " << block);
+      return;
+    }
+
+    const int64_t quantized_seed = unzigzag(seed_value);
+    cached_seed_positions_[i] = quantized_seed * JOINT_RESOLUTION;
+    cached_goal_positions_[i] = (quantized_seed + unzigzag(goal_delta)) * JOINT_RESOLUTION;
+  }
+}
+
+std::string MappedReachDatabase::id(const std::size_t index) const
+{
+  const uint64_t begin = id_offsets_[index];
+  const uint64_t end = id_offsets_[index + 1];
+  if (begin > end || end > id_chars_size_)
+  {
+    return {};
+  }
+
+  return std::string(id_chars_ + begin, id_chars_ + end);
+}
+
+reach_msgs::ReachRecord MappedReachDatabase::record(const std::size_t index) const
+{
+  reach_msgs::ReachRecord r;
+  r.id = id(index);
+  r.reached = reached(index);
+  r.score = score(index);
+  r.goal = goal(index);
+  r.seed_state.name = joint_names_;
+  r.seed_state.position = seedPosition(index);
+  r.goal_state.name = joint_names_;
+  r.goal_state.position = goalPosition(index);
+  return r;
+}
+
+}  // namespace core
+}  // namespace reach
@@ -14,16 +14,20 @@
  * limitations under the License.
  */
 #include <reach_core/reach_study.h>
+#include <reach_core/optimization.h>
+#include <reach_core/region_analysis.h>
 #include <reach_core/utils/serialization_utils.h>
 #include <reach_core/utils/general_utils.h>
+#include <reach_core/utils/parallel_utils.h>
 
 #include <reach_msgs/LoadPointCloud.h>
 #include <reach_msgs/ReachRecord.h>
 
-#include <numeric>
+#include <boost/crc.hpp>
 #include <eigen_conversions/eigen_msg.h>
 #include <pluginlib/class_loader.h>
 #include <ros/package.h>
+#include <algorithm>
 #include <thread>
 #include <xmlrpcpp/XmlRpcException.h>
 
@@ -32,6 +36,8 @@ const static double SRV_TIMEOUT = 5.0;
 const static std::string INPUT_CLOUD_TOPIC = "input_cloud";
 const static std::string SAVED_DB_NAME = "reach.db";
 const static std::string OPT_SAVED_DB_NAME = "optimized_reach.db";
+const static std::string CHECKPOINT_DB_NAME = "reach.db.checkpoint";
+const static std::string NEIGHBOR_GRAPH_NAME = "neighbor_graph.bin";
 
 namespace reach
 {
@@ -52,6 +58,8 @@ ReachStudy::ReachStudy(const ros::NodeHandle& nh)
 
 bool ReachStudy::initializeStudy()
 {
+  thread_pool_.reset();
+  solver_pool_.reset();
   ik_solver_.reset();
   display_.reset();
 
@@ -77,6 +85,44 @@ bool ReachStudy::initializeStudy()
     return false;
   }
 
+  // Create an independent IK solver for each worker thread
+  auto factory = [this]() -> reach::plugins::IKSolverBasePtr {
+    try
+    {
+      reach::plugins::IKSolverBasePtr solver = solver_loader_.createInstance(sp_.ik_solver_config["name"]);
+      if (solver->initialize(sp_.ik_solver_config))
+      {
+        return solver;
+      }
+    }
+    catch (const XmlRpc::XmlRpcException& ex)
+    {
+      ROS_ERROR_STREAM(ex.getMessage());
+    }
+    catch (const pluginlib::PluginlibException& ex)
+    {
+      ROS_ERROR_STREAM(ex.what());
+    }
+    return nullptr;
+  };
+  solver_pool_.reset(new IKSolverPool(ik_solver_, std::max(std::thread::hardware_concurrency(), 1u), factory));
+  if (solver_pool_->size() == 0)
+  {
+    ROS_ERROR("Failed to create the IK solvers of the workers");
+    return false;
+  }
+  thread_pool_.reset(new utils::ThreadPool(solver_pool_->size()));
+
+  // Find neighboring points with the configured type of spatial index
+  const SpatialIndexFactory index_factory =
+      getSpatialIndexFactory(sp_.optimization.spatial_index, sp_.optimization.radius);
+  if (!index_factory)
+  {
+    ROS_ERROR_STREAM("Unknown spatial index type '" << sp_.optimization.spatial_index << "'");
+    return false;
+  }
+  db_->setSpatialIndexFactory(index_factory);
+
   display_->showEnvironment();
 
   // Create a directory to store results of study
@@ -132,9 +178,19 @@ bool ReachStudy::run(const StudyParameters& sp)
     // Attempt to load previously saved initial reach study database
     if (!db_->load(results_dir_ + SAVED_DB_NAME))
     {
-      ROS_INFO("------------------------------");
-      ROS_INFO("No reach study database loaded");
-      ROS_INFO("------------------------------");
+      // Attempt to resume an interrupted initial reach study from its checkpoint
+      if (db_->loadCheckpoint(results_dir_ + CHECKPOINT_DB_NAME, cloud_->points.size(), studyChecksum()))
+      {
+        ROS_INFO("----------------------------------------------------");
+        ROS_INFO_STREAM("Resuming reach study from checkpoint of " << db_->size() << " points");
+        ROS_INFO("----------------------------------------------------");
+      }
+      else
+      {
+        ROS_INFO("------------------------------");
+        ROS_INFO("No reach study database loaded");
+        ROS_INFO("------------------------------");
+      }
 
       // Run the first pass of the reach study
       runInitialReachStudy();
@@ -151,18 +207,6 @@ bool ReachStudy::run(const StudyParameters& sp)
       visualizer_->update();
     }
 
-    // Create an efficient search tree for doing nearest neighbors search
-    {
-      auto cloud = pcl::make_shared<pcl::PointCloud<pcl::PointXYZ>>();
-      for (auto it = db_->begin(); it != db_->end(); ++it)
-      {
-        pcl::PointXYZ pt(it->second.goal.position.x, it->second.goal.position.y, it->second.goal.position.z);
-        cloud->push_back(pt);
-      }
-      search_tree_ = pcl::make_shared<pcl::search::KdTree<pcl::PointXYZ>>();
-      search_tree_->setInputCloud(cloud);
-    }
-
     // Run the optimization
     optimizeReachStudyResults();
     db_->printResults();
@@ -178,6 +222,12 @@ bool ReachStudy::run(const StudyParameters& sp)
     visualizer_->update();
   }
 
+  // Let the visualizer find neighbors without searching the database, unless the graph would only be built for it
+  if (neighbor_graph_ || sp_.visualize_results)
+  {
+    visualizer_->setNeighborGraph(getNeighborGraph());
+  }
+
   // Find the average number of neighboring points can be reached by the robot from any given point
   if (sp_.get_neighbors)
   {
@@ -235,19 +285,42 @@ bool ReachStudy::getReachObjectPointCloud()
   return true;
 }
 
+uint32_t ReachStudy::studyChecksum() const
+{
+  boost::crc_32_type crc;
+  for (const pcl::PointNormal& pt : cloud_->points)
+  {
+    const float values[6] = { pt.x, pt.y, pt.z, pt.normal_x, pt.normal_y, pt.normal_z };
+    crc.process_bytes(values, sizeof(values));
+  }
+
+  const std::string config = sp_.fixed_frame + '\n' + sp_.object_frame + '\n' + sp_.ik_solver_config.toXml();
+  crc.process_bytes(config.data(), config.size());
+  return crc.checksum();
+}
+
 void ReachStudy::runInitialReachStudy()
 {
   // Rotation to flip the Z axis of the surface normal point
   const Eigen::AngleAxisd tool_z_rot(M_PI, Eigen::Vector3d::UnitY());
 
   // Loop through all points in point cloud and get IK solution
-  std::atomic<int> current_counter, previous_pct;
-  current_counter = previous_pct = 0;
+  std::atomic<int> current_counter, previous_pct, n_solved;
+  current_counter = previous_pct = n_solved = 0;
   const int cloud_size = static_cast<int>(cloud_->points.size());
+  const std::string checkpoint_file = results_dir_ + CHECKPOINT_DB_NAME;
+  const uint32_t checksum = studyChecksum();
+
+  auto solve = [&](const std::size_t i, const std::size_t worker) {
+    // Skip points that were solved before the study was interrupted
+    if (db_->get(i))
+    {
+      current_counter++;
+      return;
+    }
+
+    const reach::plugins::IKSolverBasePtr& solver = solver_pool_->get(worker);
 
-#pragma omp parallel for num_threads(std::thread::hardware_concurrency())
-  for (int i = 0; i < cloud_size; ++i)
-  {
     // Get pose from point cloud array
     const pcl::PointNormal& pt = cloud_->points[i];
     Eigen::Isometry3d tgt_frame;
@@ -256,12 +329,12 @@ void ReachStudy::runInitialReachStudy()
 
     // Get the seed position
     sensor_msgs::JointState seed_state;
-    seed_state.name = ik_solver_->getJointNames();
+    seed_state.name = solver->getJointNames();
     seed_state.position = std::vector<double>(seed_state.name.size(), 0.0);
 
     // Solve IK
     std::vector<double> solution;
-    boost::optional<double> score = ik_solver_->solveIKFromSeed(tgt_frame, jointStateMsgToMap(seed_state), solution);
+    boost::optional<double> score = solver->solveIKFromSeed(tgt_frame, jointStateMsgToMap(seed_state), solution);
 
     // Create objects to save in the reach record
     geometry_msgs::Pose tgt_pose;
@@ -281,14 +354,26 @@ void ReachStudy::runInitialReachStudy()
       db_->put(msg);
     }
 
+    // Periodically append the records solved since the previous checkpoint to the checkpoint file
+    if (sp_.checkpoint_interval > 0 && ++n_solved % sp_.checkpoint_interval == 0)
+    {
+      if (!db_->checkpoint(checkpoint_file, cloud_->points.size(), checksum))
+      {
+        ROS_WARN_STREAM("Failed to write reach study checkpoint to '" << checkpoint_file << "'");
+      }
+    }
+
     // Print function progress
     current_counter++;
     utils::integerProgressPrinter(current_counter, previous_pct, cloud_size);
-  }
+  };
+  thread_pool_->parallelFor(cloud_size, sp_.grain_size, solve);
 
   // Save the results of the reach study to a database that we can query later
-  db_->calculateResults();
-  db_->save(results_dir_ + SAVED_DB_NAME);
+  db_->save(results_dir_ + SAVED_DB_NAME, sp_.compact_database);
+
+  // The checkpoint is superseded by the saved database
+  boost::filesystem::remove(checkpoint_file);
 }
 
 void ReachStudy::optimizeReachStudyResults()
@@ -296,53 +381,38 @@ void ReachStudy::optimizeReachStudyResults()
   ROS_INFO("----------------------");
   ROS_INFO("Beginning optimization");
 
-  // Create sequential vector to be randomized
-  std::vector<std::size_t> rand_vec(db_->size());
-  std::iota(rand_vec.begin(), rand_vec.end(), 0);
-
-  // Iterate
-  std::atomic<int> current_counter, previous_pct;
-  const int cloud_size = static_cast<int>(cloud_->size());
-  int n_opt = 0;
-  float previous_score = 0.0;
-  float pct_improve = 1.0;
+  // Partition the points into groups with non-overlapping neighborhoods, such that the members of each group can be
+  // optimized in parallel without two threads updating the same record
+  const NeighborGraphConstPtr graph = getNeighborGraph();
+  const std::vector<std::vector<std::size_t>> groups = colorNeighborhoods(*graph);
+  ROS_INFO_STREAM("Optimizing " << groups.size() << " groups of points with non-overlapping neighborhoods");
 
-  while (pct_improve > sp_.optimization.step_improvement_threshold && n_opt < sp_.optimization.max_steps)
+  // Report the distribution of the group sizes; groups with fewer members than there are workers leave workers idle
+  if (!groups.empty())
   {
-    ROS_INFO("Entering optimization loop %d", n_opt);
-    previous_score = db_->getStudyResults().norm_total_pose_score;
-    current_counter = 0;
-    previous_pct = 0;
-
-    // Randomize
-    std::random_shuffle(rand_vec.begin(), rand_vec.end());
-
-#pragma parallel for num_threads(std::thread::hardware_concurrency())
-    for (std::size_t i = 0; i < rand_vec.size(); ++i)
+    std::vector<std::size_t> sizes;
+    for (const std::vector<std::size_t>& group : groups)
     {
-      auto it = db_->begin();
-      std::advance(it, rand_vec[i]);
-      reach_msgs::ReachRecord msg = it->second;
-      if (msg.reached)
-      {
-        NeighborReachResult result = reachNeighborsDirect(db_, msg, ik_solver_, sp_.optimization.radius, search_tree_);
-      }
-
-      // Print function progress
-      current_counter++;
-      utils::integerProgressPrinter(current_counter, previous_pct, cloud_size);
+      sizes.push_back(group.size());
     }
+    std::sort(sizes.begin(), sizes.end());
+    const std::size_t n_small = static_cast<std::size_t>(
+        std::distance(sizes.begin(), std::lower_bound(sizes.begin(), sizes.end(), thread_pool_->size())));
+    ROS_INFO_STREAM("Group sizes: smallest " << sizes.front() << ", median " << sizes[sizes.size() / 2]
+                                             << ", largest " << sizes.back() << "; " << n_small
+                                             << " groups have fewer members than the " << thread_pool_->size()
+                                             << " workers");
+  }
 
-    // Recalculate optimized reach study results
-    db_->calculateResults();
-    db_->printResults();
-    pct_improve = std::abs((db_->getStudyResults().norm_total_pose_score - previous_score) / previous_score);
-    ++n_opt;
+  const OptimizationResult result = optimizeReachDatabase(*db_, groups, graph, *solver_pool_, *thread_pool_,
+                                                          sp_.optimization, sp_.grain_size);
+  if (result.converged)
+  {
+    ROS_INFO("Optimization converged after %d loops", result.n_loops);
   }
 
   // Save the optimized reach database
-  db_->calculateResults();
-  db_->save(results_dir_ + OPT_SAVED_DB_NAME);
+  db_->save(results_dir_ + OPT_SAVED_DB_NAME, sp_.compact_database);
 
   ROS_INFO("----------------------");
   ROS_INFO("Optimization concluded");
@@ -353,41 +423,55 @@ void ReachStudy::getAverageNeighborsCount()
   ROS_INFO("--------------------------------------------");
   ROS_INFO("Beginning average neighbor count calculation");
 
-  std::atomic<int> current_counter, previous_pct, neighbor_count;
-  current_counter = previous_pct = neighbor_count = 0;
-  std::atomic<double> total_joint_distance;
-  const int total = db_->size();
-
-// Iterate
-#pragma parallel for num_threads(std::thread::hardware_concurrency())
-  for (auto it = db_->begin(); it != db_->end(); ++it)
-  {
-    reach_msgs::ReachRecord msg = it->second;
-    if (msg.reached)
-    {
-      NeighborReachResult result;
-      reachNeighborsRecursive(db_, msg, ik_solver_, sp_.optimization.radius, result, search_tree_);
+  // Find the regions over which the robot can move from neighbor to neighbor, solving IK once per neighbor pair
+  const NeighborGraphConstPtr graph = getNeighborGraph();
+  const RegionAnalysisResult regions = analyzeRegions(*db_, *graph, *solver_pool_, *thread_pool_, sp_.grain_size);
 
-      neighbor_count += static_cast<int>(result.reached_pts.size() - 1);
-      total_joint_distance = total_joint_distance + result.joint_distance;
-    }
+  const float avg_neighbor_count = static_cast<float>(regions.avg_num_neighbors);
+  const float avg_joint_distance = static_cast<float>(regions.avg_joint_distance);
 
-    // Print function progress
-    ++current_counter;
-    utils::integerProgressPrinter(current_counter, previous_pct, total);
+  ROS_INFO_STREAM("Solved " << regions.n_moves << " of " << regions.n_attempts << " moves between neighbors");
+  ROS_INFO_STREAM("Number of reachable regions: " << regions.region_sizes.size());
+  if (!regions.region_sizes.empty())
+  {
+    ROS_INFO_STREAM("Size of the largest reachable region: " << regions.region_sizes.front());
   }
-
-  float avg_neighbor_count = static_cast<float>(neighbor_count.load()) / static_cast<float>(db_->size());
-  float avg_joint_distance =
-      static_cast<float>(total_joint_distance.load()) / static_cast<float>(neighbor_count.load());
-
   ROS_INFO_STREAM("Average number of neighbors reached: " << avg_neighbor_count);
-  ROS_INFO_STREAM("Average joint distance: " << avg_joint_distance);
+  ROS_INFO_STREAM("Average joint distance per move between neighbors: " << avg_joint_distance);
   ROS_INFO("------------------------------------------------");
 
   db_->setAverageNeighborsCount(avg_neighbor_count);
   db_->setAverageJointDistance(avg_joint_distance);
-  db_->save(results_dir_ + OPT_SAVED_DB_NAME);
+  db_->save(results_dir_ + OPT_SAVED_DB_NAME, sp_.compact_database);
+}
+
+NeighborGraphConstPtr ReachStudy::getNeighborGraph()
+{
+  if (neighbor_graph_)
+  {
+    return neighbor_graph_;
+  }
+
+  // Load the graph saved by a previous run for the same points and radius, or build and save it otherwise
+  const std::string filename = results_dir_ + NEIGHBOR_GRAPH_NAME;
+  auto graph = std::make_shared<NeighborGraph>();
+  if (graph->load(filename, *db_, sp_.optimization.radius, sp_.optimization.max_neighbor_angle))
+  {
+    ROS_INFO_STREAM("Loaded neighbor graph with " << graph->numEdges() << " edges");
+  }
+  else
+  {
+    graph->build(*db_, sp_.optimization.radius, sp_.optimization.max_neighbor_angle, *thread_pool_);
+    ROS_INFO_STREAM("Built neighbor graph with " << graph->numEdges() << " edges");
+
+    if (!graph->save(filename))
+    {
+      ROS_WARN_STREAM("Failed to save neighbor graph to '" << filename << "'");
+    }
+  }
+
+  neighbor_graph_ = graph;
+  return neighbor_graph_;
 }
 
 bool ReachStudy::compareDatabases()
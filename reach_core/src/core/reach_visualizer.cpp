@@ -23,9 +23,8 @@ namespace reach
 namespace core
 {
 ReachVisualizer::ReachVisualizer(ReachDatabasePtr db, reach::plugins::IKSolverBasePtr solver,
-                                 reach::plugins::DisplayBasePtr display, const double neighbor_radius,
-                                 SearchTreePtr search_tree)
-  : db_(db), solver_(solver), display_(display), search_tree_(search_tree), neighbor_radius_(neighbor_radius)
+                                 reach::plugins::DisplayBasePtr display, const double neighbor_radius)
+  : db_(db), solver_(solver), display_(display), neighbor_radius_(neighbor_radius)
 {
   // Create menu functions for the display and tie them to members of this class
   using CBType = interactive_markers::MenuHandler::FeedbackCallback;
@@ -130,7 +129,8 @@ void ReachVisualizer::reachNeighborsDirectCB(const visualization_msgs::Interacti
   auto lookup = db_->get(fb->marker_name);
   if (lookup)
   {
-    NeighborReachResult result = reachNeighborsDirect(db_, *lookup, solver_, neighbor_radius_, search_tree_);
+    NeighborReachResult result =
+        reachNeighborsDirect(db_, *lookup, solver_, neighbor_radius_, std::atomic_load(&graph_));
 
     display_->updateRobotPose(jointStateMsgToMap(lookup->goal_state));
     display_->publishMarkerArray(result.reached_pts);
@@ -149,8 +149,8 @@ void ReachVisualizer::reachNeighborsRecursiveCB(const visualization_msgs::Intera
   auto lookup = db_->get(fb->marker_name);
   if (lookup)
   {
-    NeighborReachResult result;
-    reachNeighborsRecursive(db_, *lookup, solver_, neighbor_radius_, result, search_tree_);
+    const NeighborReachResult result =
+        reachNeighborsRecursive(db_, *lookup, solver_, neighbor_radius_, std::atomic_load(&graph_));
 
     display_->updateRobotPose(jointStateMsgToMap(lookup->goal_state));
     display_->publishMarkerArray(result.reached_pts);
@@ -0,0 +1,275 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <reach_core/region_analysis.h>
+#include <reach_core/utils/general_utils.h>
+#include <reach_core/utils/parallel_utils.h>
+
+#include <eigen_conversions/eigen_msg.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+/**
+ * @brief Disjoint sets of indices that can be merged concurrently without locks. Each set is represented by its
+ * smallest index, so the result does not depend on the order in which sets are merged
+ */
+class ConcurrentDisjointSets
+{
+public:
+  explicit ConcurrentDisjointSets(const std::size_t n) : parents_(n)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      parents_[i].store(i, std::memory_order_relaxed);
+    }
+  }
+
+  std::size_t find(std::size_t x)
+  {
+    while (true)
+    {
+      std::size_t parent = parents_[x].load();
+      if (parent == x)
+        return x;
+
+      // Point the index at its grandparent (path halving); failing to do so only leaves the path longer
+      const std::size_t grandparent = parents_[parent].load();
+      if (grandparent != parent)
+        parents_[x].compare_exchange_weak(parent, grandparent);
+      x = grandparent;
+    }
+  }
+
+  void merge(std::size_t a, std::size_t b)
+  {
+    while (true)
+    {
+      a = find(a);
+      b = find(b);
+      if (a == b)
+        return;
+
+      // Link the larger root below the smaller root, unless another thread has linked it in the meantime
+      if (a < b)
+        std::swap(a, b);
+      std::size_t expected = a;
+      if (parents_[a].compare_exchange_strong(expected, b))
+        return;
+    }
+  }
+
+private:
+  std::vector<std::atomic<std::size_t>> parents_;
+};
+
+}  // namespace
+
+namespace reach
+{
+namespace core
+{
+RegionAnalysisResult analyzeRegions(const ReachDatabase& db, const NeighborGraph& graph, const IKSolverPool& solvers,
+                                    utils::ThreadPool& pool, const std::size_t grain_size)
+{
+  const std::size_t n = std::min(db.size(), graph.size());
+
+  std::vector<char> reached(n, 0);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const boost::optional<reach_msgs::ReachRecord> rec = db.get(i);
+    reached[i] = rec && rec->reached;
+  }
+
+  // Point from which each point that the reach study did not reach was first moved to, and the IK solution with which
+  // it was reached. A point is claimed in the first round in which a move to it succeeds, by the lowest index from
+  // which it succeeded in that round, such that the regions do not depend on the number of workers
+  const std::size_t unclaimed = std::numeric_limits<std::size_t>::max();
+  std::vector<std::size_t> sources(n, unclaimed);
+  std::vector<std::vector<double>> arrivals(n);
+
+  // Successful moves to unclaimed points found by the workers during a round
+  struct Move
+  {
+    std::size_t target;
+    std::size_t source;
+    std::vector<double> solution;
+  };
+  std::vector<std::vector<Move>> moves_to_unclaimed(solvers.size());
+
+  ConcurrentDisjointSets sets(n);
+  std::vector<std::size_t> attempts(solvers.size(), 0);
+  std::vector<std::size_t> moves(solvers.size(), 0);
+
+  // The points expanded in the first round are the reached points, and in each later round the points claimed in the
+  // round before
+  std::vector<std::size_t> frontier;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    if (reached[i])
+      frontier.push_back(i);
+  }
+
+  // Joint distance travelled by the moves out of each point, summed in index order such that the total does not depend
+  // on the order in which the workers finished
+  std::vector<double> joint_distances(n, 0.0);
+
+  std::atomic<int> current_counter, previous_pct;
+  current_counter = previous_pct = 0;
+  int total = static_cast<int>(frontier.size());
+
+  while (!frontier.empty())
+  {
+    auto analyze = [&](const std::size_t f, const std::size_t worker) {
+      const std::size_t i = frontier[f];
+      const reach_msgs::ReachRecord rec = *db.get(i);
+      const std::vector<double>& positions = reached[i] ? rec.goal_state.position : arrivals[i];
+
+      std::map<std::string, double> seed;
+      for (std::size_t j = 0; j < positions.size() && j < rec.goal_state.name.size(); ++j)
+      {
+        seed.emplace(rec.goal_state.name[j], positions[j]);
+      }
+
+      const reach::plugins::IKSolverBasePtr& solver = solvers.get(worker);
+      std::vector<double> solution;
+      for (const uint32_t neighbor : graph.neighbors(i))
+      {
+        // The move across an edge between two reached points is attempted from the lower index only, and a claimed
+        // point does not move back to the point from which it was claimed
+        if (neighbor >= n || (reached[i] && reached[neighbor] && neighbor < i) || neighbor == sources[i])
+          continue;
+
+        const boost::optional<reach_msgs::ReachRecord> target_rec = db.get(static_cast<std::size_t>(neighbor));
+        if (!target_rec)
+          continue;
+
+        Eigen::Isometry3d target;
+        tf::poseMsgToEigen(target_rec->goal, target);
+
+        ++attempts[worker];
+        solution.clear();
+        if (!solver->solveIKFromSeed(target, seed, solution))
+          continue;
+
+        for (std::size_t j = 0; j < positions.size() && j < solution.size(); ++j)
+        {
+          joint_distances[i] += std::abs(solution[j] - positions[j]);
+        }
+        ++moves[worker];
+
+        // A point that is reached or claimed joins the region of this point. An unclaimed point only joins the region
+        // of the point that claims it, with the solution of that move
+        if (reached[neighbor] || sources[neighbor] != unclaimed)
+          sets.merge(i, neighbor);
+        else
+          moves_to_unclaimed[worker].push_back(Move{ neighbor, i, solution });
+      }
+
+      // Print function progress
+      ++current_counter;
+      utils::integerProgressPrinter(current_counter, previous_pct, total);
+    };
+    pool.parallelFor(frontier.size(), grain_size, analyze);
+
+    // Claim the points moved to in this round, and expand them in the next round
+    frontier.clear();
+    for (std::vector<Move>& worker_moves : moves_to_unclaimed)
+    {
+      for (Move& move : worker_moves)
+      {
+        if (sources[move.target] == unclaimed)
+          frontier.push_back(move.target);
+
+        if (move.source < sources[move.target])
+        {
+          sources[move.target] = move.source;
+          arrivals[move.target] = std::move(move.solution);
+        }
+      }
+      worker_moves.clear();
+    }
+    std::sort(frontier.begin(), frontier.end());
+    for (const std::size_t i : frontier)
+    {
+      sets.merge(i, sources[i]);
+    }
+    total += static_cast<int>(frontier.size());
+  }
+
+  RegionAnalysisResult result;
+  result.n_attempts = std::accumulate(attempts.begin(), attempts.end(), static_cast<std::size_t>(0));
+  result.n_moves = std::accumulate(moves.begin(), moves.end(), static_cast<std::size_t>(0));
+  const double total_joint_distance = std::accumulate(joint_distances.begin(), joint_distances.end(), 0.0);
+  if (result.n_moves > 0)
+  {
+    result.avg_joint_distance = total_joint_distance / static_cast<double>(result.n_moves);
+  }
+
+  // Count the points of each region, indexed by the root of its set
+  std::vector<std::size_t> root_sizes(n, 0);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    if (reached[i] || sources[i] != unclaimed)
+    {
+      ++root_sizes[sets.find(i)];
+    }
+  }
+
+  // Number the regions in order of decreasing size
+  std::vector<std::size_t> roots;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    if (root_sizes[i] > 0)
+      roots.push_back(i);
+  }
+  std::stable_sort(roots.begin(), roots.end(),
+                   [&](const std::size_t a, const std::size_t b) { return root_sizes[a] > root_sizes[b]; });
+
+  std::vector<int> root_regions(n, -1);
+  for (std::size_t r = 0; r < roots.size(); ++r)
+  {
+    root_regions[roots[r]] = static_cast<int>(r);
+    result.region_sizes.push_back(root_sizes[roots[r]]);
+  }
+
+  // Each reached point can move to every other point of its region
+  result.regions.assign(db.size(), -1);
+  std::size_t neighbor_count = 0;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    if (reached[i] || sources[i] != unclaimed)
+    {
+      const std::size_t root = sets.find(i);
+      result.regions[i] = root_regions[root];
+      if (reached[i])
+        neighbor_count += root_sizes[root] - 1;
+    }
+  }
+
+  if (db.size() > 0)
+  {
+    result.avg_num_neighbors = static_cast<double>(neighbor_count) / static_cast<double>(db.size());
+  }
+
+  return result;
+}
+
+}  // namespace core
+}  // namespace reach
@@ -0,0 +1,403 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <reach_core/spatial_index.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+
+namespace
+{
+// Number of cells along each side of each face of the cube onto which directions are projected
+const int CELLS_PER_SIDE = 4;
+
+// Number of points whose distances the brute-force search computes at a time
+const int BLOCK_SIZE = 256;
+
+/**
+ * @brief Returns the bin of a unit direction: the face of the cube through which it passes, and the cell of that face
+ */
+int directionBin(const Eigen::Vector3f& direction)
+{
+  int axis = 0;
+  direction.cwiseAbs().maxCoeff(&axis);
+  const int face = 2 * axis + (direction[axis] < 0.0f ? 1 : 0);
+
+  // Project the direction onto the face, whose coordinates lie on [-1, 1]
+  const float scale = std::abs(direction[axis]);
+  const float u = scale > 0.0f ? direction[(axis + 1) % 3] / scale : 0.0f;
+  const float v = scale > 0.0f ? direction[(axis + 2) % 3] / scale : 0.0f;
+  auto cell = [](const float c) {
+    return std::min(std::max(static_cast<int>((c + 1.0f) * 0.5f * CELLS_PER_SIDE), 0), CELLS_PER_SIDE - 1);
+  };
+
+  return (face * CELLS_PER_SIDE + cell(u)) * CELLS_PER_SIDE + cell(v);
+}
+
+double angleBetween(const Eigen::Vector3f& a, const Eigen::Vector3f& b)
+{
+  return std::acos(std::min(std::max(static_cast<double>(a.dot(b)), -1.0), 1.0));
+}
+
+}  // namespace
+
+namespace reach
+{
+namespace core
+{
+void KdTreeIndex::build(const std::vector<Eigen::Vector3f>& points)
+{
+  auto cloud = pcl::make_shared<pcl::PointCloud<pcl::PointXYZ>>();
+  cloud->reserve(points.size());
+  for (const Eigen::Vector3f& pt : points)
+  {
+    cloud->push_back(pcl::PointXYZ(pt.x(), pt.y(), pt.z()));
+  }
+
+  tree_ = pcl::make_shared<pcl::search::KdTree<pcl::PointXYZ>>();
+  if (!cloud->empty())
+  {
+    tree_->setInputCloud(cloud);
+  }
+}
+
+void KdTreeIndex::radiusSearch(const Eigen::Vector3f& query, const double radius,
+                               std::vector<std::size_t>& indices) const
+{
+  indices.clear();
+  if (!tree_ || !tree_->getInputCloud())
+    return;
+
+  std::vector<int> tree_indices;
+  std::vector<float> distances;
+  tree_->radiusSearch(pcl::PointXYZ(query.x(), query.y(), query.z()), radius, tree_indices, distances);
+  indices.assign(tree_indices.begin(), tree_indices.end());
+}
+
+void KdTreeIndex::nearestKSearch(const Eigen::Vector3f& query, const std::size_t k,
+                                 std::vector<std::size_t>& indices) const
+{
+  indices.clear();
+  if (!tree_ || !tree_->getInputCloud() || k == 0)
+    return;
+
+  std::vector<int> tree_indices;
+  std::vector<float> distances;
+  tree_->nearestKSearch(pcl::PointXYZ(query.x(), query.y(), query.z()), static_cast<int>(k), tree_indices, distances);
+  indices.assign(tree_indices.begin(), tree_indices.end());
+}
+
+void BruteForceIndex::build(const std::vector<Eigen::Vector3f>& points)
+{
+  const Eigen::Index n = static_cast<Eigen::Index>(points.size());
+  x_.resize(n);
+  y_.resize(n);
+  z_.resize(n);
+  for (Eigen::Index i = 0; i < n; ++i)
+  {
+    x_[i] = points[i].x();
+    y_[i] = points[i].y();
+    z_[i] = points[i].z();
+  }
+}
+
+void BruteForceIndex::radiusSearch(const Eigen::Vector3f& query, const double radius,
+                                   std::vector<std::size_t>& indices) const
+{
+  indices.clear();
+  const float radius_sq = static_cast<float>(radius * radius);
+
+  // Compute the squared distances of a block of points at a time, such that they stay in the L1 cache
+  Eigen::Array<float, BLOCK_SIZE, 1> distances_sq;
+  const Eigen::Index n = x_.size();
+  for (Eigen::Index begin = 0; begin < n; begin += BLOCK_SIZE)
+  {
+    const Eigen::Index size = std::min<Eigen::Index>(BLOCK_SIZE, n - begin);
+    auto d = distances_sq.head(size);
+    d = (x_.segment(begin, size) - query.x()).square() + (y_.segment(begin, size) - query.y()).square() +
+        (z_.segment(begin, size) - query.z()).square();
+
+    for (Eigen::Index i = 0; i < size; ++i)
+    {
+      if (d[i] <= radius_sq)
+        indices.push_back(static_cast<std::size_t>(begin + i));
+    }
+  }
+}
+
+void BruteForceIndex::nearestKSearch(const Eigen::Vector3f& query, const std::size_t k,
+                                     std::vector<std::size_t>& indices) const
+{
+  indices.clear();
+  const std::size_t n = static_cast<std::size_t>(x_.size());
+  if (k == 0 || n == 0)
+    return;
+
+  const Eigen::ArrayXf distances_sq = (x_ - query.x()).square() + (y_ - query.y()).square() + (z_ - query.z()).square();
+
+  indices.resize(n);
+  std::iota(indices.begin(), indices.end(), 0);
+  auto closer = [&](const std::size_t a, const std::size_t b) {
+    return distances_sq[a] < distances_sq[b] || (distances_sq[a] == distances_sq[b] && a < b);
+  };
+
+  const std::size_t n_found = std::min(k, n);
+  std::partial_sort(indices.begin(), indices.begin() + n_found, indices.end(), closer);
+  indices.resize(n_found);
+}
+
+VoxelGridIndex::VoxelGridIndex(const double cell_size) : cell_size_(static_cast<float>(cell_size))
+{
+}
+
+std::size_t VoxelGridIndex::CellHash::operator()(const Eigen::Vector3i& cell) const
+{
+  // Large primes, as proposed by Teschner et al. for spatial hashing
+  return static_cast<std::size_t>((static_cast<int64_t>(cell.x()) * 73856093) ^
+                                  (static_cast<int64_t>(cell.y()) * 19349663) ^
+                                  (static_cast<int64_t>(cell.z()) * 83492791));
+}
+
+Eigen::Vector3i VoxelGridIndex::cellOf(const Eigen::Vector3f& point) const
+{
+  return (point / cell_size_).array().floor().cast<int>();
+}
+
+void VoxelGridIndex::build(const std::vector<Eigen::Vector3f>& points)
+{
+  cells_.clear();
+  points_.clear();
+  indices_.clear();
+
+  // Sort the points by cell, such that the points of each cell are contiguous
+  std::vector<Eigen::Vector3i> point_cells(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i)
+  {
+    point_cells[i] = cellOf(points[i]);
+  }
+
+  indices_.resize(points.size());
+  std::iota(indices_.begin(), indices_.end(), 0);
+  std::sort(indices_.begin(), indices_.end(), [&](const std::size_t a, const std::size_t b) {
+    const Eigen::Vector3i& ca = point_cells[a];
+    const Eigen::Vector3i& cb = point_cells[b];
+    return std::tie(ca.x(), ca.y(), ca.z(), a) < std::tie(cb.x(), cb.y(), cb.z(), b);
+  });
+
+  points_.reserve(points.size());
+  min_cell_.setConstant(std::numeric_limits<int>::max());
+  max_cell_.setConstant(std::numeric_limits<int>::min());
+  for (std::size_t j = 0; j < indices_.size(); ++j)
+  {
+    const Eigen::Vector3i& cell = point_cells[indices_[j]];
+    points_.push_back(points[indices_[j]]);
+
+    auto range = cells_.emplace(cell, std::make_pair(static_cast<uint32_t>(j), static_cast<uint32_t>(j)));
+    range.first->second.second = static_cast<uint32_t>(j + 1);
+
+    min_cell_ = min_cell_.cwiseMin(cell);
+    max_cell_ = max_cell_.cwiseMax(cell);
+  }
+}
+
+template <typename Function>
+void VoxelGridIndex::forEachInRadius(const Eigen::Vector3f& query, const double radius, Function&& fn) const
+{
+  if (points_.empty())
+    return;
+
+  const float radius_f = static_cast<float>(radius);
+  const float radius_sq = radius_f * radius_f;
+  auto search_cell = [&](const std::pair<uint32_t, uint32_t>& range) {
+    for (uint32_t j = range.first; j < range.second; ++j)
+    {
+      const float distance_sq = (points_[j] - query).squaredNorm();
+      if (distance_sq <= radius_sq)
+        fn(j, distance_sq);
+    }
+  };
+
+  // Visit the occupied cells that overlap the bounding box of the search sphere
+  const Eigen::Vector3i lo = cellOf(query.array() - radius_f).cwiseMax(min_cell_);
+  const Eigen::Vector3i hi = cellOf(query.array() + radius_f).cwiseMin(max_cell_);
+  if ((hi.array() < lo.array()).any())
+    return;
+
+  // Visit all of the occupied cells instead if there are fewer of them than cells in the bounding box
+  const Eigen::Vector3d extent = (hi - lo).cast<double>().array() + 1.0;
+  if (extent.prod() > static_cast<double>(cells_.size()))
+  {
+    for (const auto& cell : cells_)
+    {
+      search_cell(cell.second);
+    }
+    return;
+  }
+
+  Eigen::Vector3i cell;
+  for (cell.x() = lo.x(); cell.x() <= hi.x(); ++cell.x())
+  {
+    for (cell.y() = lo.y(); cell.y() <= hi.y(); ++cell.y())
+    {
+      for (cell.z() = lo.z(); cell.z() <= hi.z(); ++cell.z())
+      {
+        const auto it = cells_.find(cell);
+        if (it != cells_.end())
+          search_cell(it->second);
+      }
+    }
+  }
+}
+
+void VoxelGridIndex::radiusSearch(const Eigen::Vector3f& query, const double radius,
+                                  std::vector<std::size_t>& indices) const
+{
+  indices.clear();
+  forEachInRadius(query, radius, [&](const uint32_t j, const float) { indices.push_back(indices_[j]); });
+}
+
+void VoxelGridIndex::nearestKSearch(const Eigen::Vector3f& query, const std::size_t k,
+                                    std::vector<std::size_t>& indices) const
+{
+  indices.clear();
+  if (k == 0 || points_.empty())
+    return;
+
+  // Search with a growing radius until it contains k points (or all of the points), which must include the k nearest
+  const float max_radius = (query - points_.front()).norm() +
+                           ((max_cell_ - min_cell_).cast<float>().array() + 1.0f).matrix().norm() * cell_size_;
+  std::vector<std::pair<float, std::size_t>> found;
+  for (double radius = cell_size_;; radius *= 2.0)
+  {
+    found.clear();
+    forEachInRadius(query, radius,
+                    [&](const uint32_t j, const float distance_sq) { found.emplace_back(distance_sq, indices_[j]); });
+    if (found.size() >= k || radius >= max_radius)
+      break;
+  }
+
+  // The indices of the points are unique, so they break ties between equal distances deterministically
+  const std::size_t n_found = std::min(k, found.size());
+  std::partial_sort(found.begin(), found.begin() + n_found, found.end());
+  indices.resize(n_found);
+  for (std::size_t i = 0; i < n_found; ++i)
+  {
+    indices[i] = found[i].second;
+  }
+}
+
+SpatialIndexPtr makeSpatialIndex(const std::size_t n_points)
+{
+  if (n_points < BRUTE_FORCE_MAX_POINTS)
+    return std::make_shared<BruteForceIndex>();
+  return std::make_shared<KdTreeIndex>();
+}
+
+SpatialIndexFactory getSpatialIndexFactory(const std::string& name, const double cell_size)
+{
+  if (name == "auto")
+    return makeSpatialIndex;
+  if (name == "kdtree")
+    return [](const std::size_t) -> SpatialIndexPtr { return std::make_shared<KdTreeIndex>(); };
+  if (name == "brute_force")
+    return [](const std::size_t) -> SpatialIndexPtr { return std::make_shared<BruteForceIndex>(); };
+  if (name == "voxel_grid" && cell_size > 0.0)
+    return [cell_size](const std::size_t) -> SpatialIndexPtr { return std::make_shared<VoxelGridIndex>(cell_size); };
+  return SpatialIndexFactory();
+}
+
+OrientedSpatialIndex::OrientedSpatialIndex(const Factory& factory) : factory_(factory)
+{
+}
+
+void OrientedSpatialIndex::build(const std::vector<Eigen::Vector3f>& points,
+                                 const std::vector<Eigen::Vector3f>& directions)
+{
+  bins_.clear();
+  directions_.resize(points.size());
+
+  // Assign the points to the bins of their directions
+  std::unordered_map<int, std::size_t> bin_slots;
+  for (std::size_t i = 0; i < points.size(); ++i)
+  {
+    const float norm = directions[i].norm();
+    directions_[i] = norm > 0.0f ? Eigen::Vector3f(directions[i] / norm) : Eigen::Vector3f::UnitZ();
+
+    const auto slot = bin_slots.emplace(directionBin(directions_[i]), bins_.size());
+    if (slot.second)
+      bins_.emplace_back();
+    bins_[slot.first->second].points.push_back(i);
+  }
+
+  // Bound the directions of each bin by a cone, and index the positions of its points
+  std::vector<Eigen::Vector3f> bin_points;
+  for (Bin& bin : bins_)
+  {
+    Eigen::Vector3f sum = Eigen::Vector3f::Zero();
+    for (const std::size_t i : bin.points)
+    {
+      sum += directions_[i];
+    }
+    bin.axis = sum.norm() > 0.0f ? Eigen::Vector3f(sum.normalized()) : directions_[bin.points.front()];
+
+    bin.half_angle = 0.0;
+    bin_points.clear();
+    for (const std::size_t i : bin.points)
+    {
+      bin.half_angle = std::max(bin.half_angle, angleBetween(bin.axis, directions_[i]));
+      bin_points.push_back(points[i]);
+    }
+
+    bin.index = factory_(bin_points.size());
+    bin.index->build(bin_points);
+  }
+}
+
+void OrientedSpatialIndex::radiusSearch(const Eigen::Vector3f& query, const Eigen::Vector3f& direction,
+                                        const double radius, const double max_angle,
+                                        std::vector<std::size_t>& indices) const
+{
+  indices.clear();
+
+  const Eigen::Vector3f dir =
+      direction.norm() > 0.0f ? Eigen::Vector3f(direction.normalized()) : Eigen::Vector3f::UnitZ();
+  const float min_cos = static_cast<float>(std::cos(max_angle));
+
+  // Allow for the rounding of the directions
+  const double tolerance = 1.0e-5;
+
+  std::vector<std::size_t> bin_indices;
+  for (const Bin& bin : bins_)
+  {
+    // Skip the bins whose directions all differ from the query direction by more than the angle
+    if (angleBetween(dir, bin.axis) > max_angle + bin.half_angle + tolerance)
+      continue;
+
+    bin.index->radiusSearch(query, radius, bin_indices);
+    for (const std::size_t i : bin_indices)
+    {
+      const std::size_t point = bin.points[i];
+      if (max_angle >= M_PI || dir.dot(directions_[point]) >= min_cos)
+        indices.push_back(point);
+    }
+  }
+}
+
+}  // namespace core
+}  // namespace reach
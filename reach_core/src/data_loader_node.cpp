@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include "reach_core/reach_database.h"
+#include "reach_core/reach_database_file.h"
 #include <ros/ros.h>
 #include <ros/package.h>
 #include <boost/filesystem.hpp>
@@ -83,13 +84,25 @@ int main(int argc, char** argv)
     const std::string config = files[i].first.string();
     const std::string path = files[i].second.string();
 
+    // The results of columnar databases are stored in the file header, so the records don't need to be loaded
+    reach::core::StudyResults res;
+    reach::core::MappedReachDatabase file;
     reach::core::ReachDatabase db;
-    if (db.load(path))
+    if (file.open(path))
     {
-      reach::core::StudyResults res = db.getStudyResults();
-      std::cout << boost::format("%-30s %=25.3f %=25.6f %=25.3f %=25.3f\n") % config.c_str() % res.reach_percentage %
-                       res.norm_total_pose_score % res.avg_num_neighbors % res.avg_joint_distance;
+      res = file.getStudyResults();
     }
+    else if (db.load(path))
+    {
+      res = db.getStudyResults();
+    }
+    else
+    {
+      continue;
+    }
+
+    std::cout << boost::format("%-30s %=25.3f %=25.6f %=25.3f %=25.3f\n") % config.c_str() % res.reach_percentage %
+                     res.norm_total_pose_score % res.avg_num_neighbors % res.avg_joint_distance;
   }
 
   return 0;
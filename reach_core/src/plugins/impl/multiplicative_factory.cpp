@@ -85,6 +85,22 @@ double MultiplicativeFactory::calculateScore(const std::map<std::string, double>
   return score;
 }
 
+EvaluationBasePtr MultiplicativeFactory::clone() const
+{
+  boost::shared_ptr<MultiplicativeFactory> copy(new MultiplicativeFactory());
+  copy->eval_plugins_.reserve(eval_plugins_.size());
+  for (const EvaluationBasePtr& plugin : eval_plugins_)
+  {
+    EvaluationBasePtr plugin_copy = plugin->clone();
+    if (!plugin_copy)
+    {
+      return nullptr;
+    }
+    copy->eval_plugins_.push_back(std::move(plugin_copy));
+  }
+  return copy;
+}
+
 }  // namespace plugins
 }  // namespace reach
 
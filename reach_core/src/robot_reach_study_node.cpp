@@ -41,6 +41,19 @@ bool getStudyParameters(ros::NodeHandle& nh, reach::core::StudyParameters& sp)
     return false;
   }
 
+  // Optional parameters
+  nh.param<int>("grain_size", sp.grain_size, 1);
+  if (sp.grain_size < 1)
+  {
+    ROS_ERROR_STREAM("Parameter 'grain_size' must be at least 1 (got " << sp.grain_size << ")");
+    return false;
+  }
+  nh.param<int>("checkpoint_interval", sp.checkpoint_interval, 1000);
+  nh.param<bool>("compact_database", sp.compact_database, false);
+  nh.param<float>("optimization/max_neighbor_angle", sp.optimization.max_neighbor_angle, M_PI);
+  nh.param<std::string>("optimization/spatial_index", sp.optimization.spatial_index, "auto");
+  nh.param<int>("optimization/seed", sp.optimization.seed, 0);
+
   return true;
 }
 
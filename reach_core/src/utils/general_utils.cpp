@@ -24,11 +24,16 @@ void integerProgressPrinter(std::atomic<int>& current_counter, std::atomic<int>&
 {
   const float current_pct_float = (static_cast<float>(current_counter.load()) / static_cast<float>(total_size)) * 100.0;
   const int current_pct = static_cast<int>(current_pct_float);
-  if (current_pct > previous_pct.load())
+  // Only print progress that is higher than any printed before, such that the output stays monotonic if the total grows
+  int previous = previous_pct.load();
+  while (current_pct > previous)
   {
-    ROS_INFO("[%d%%]", current_pct);
+    if (previous_pct.compare_exchange_weak(previous, current_pct))
+    {
+      ROS_INFO("[%d%%]", current_pct);
+      break;
+    }
   }
-  previous_pct = current_pct;
 }
 
 Eigen::Isometry3d createFrame(const Eigen::Vector3f& pt, const Eigen::Vector3f& norm)
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <reach_core/utils/mapped_file.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace reach
+{
+namespace utils
+{
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+  close();
+
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  // The mapping remains valid after the file descriptor is closed
+  void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+  {
+    return false;
+  }
+
+  data_ = static_cast<const uint8_t*>(data);
+  size_ = static_cast<std::size_t>(st.st_size);
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (data_)
+  {
+    ::munmap(const_cast<uint8_t*>(data_), size_);
+  }
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace utils
+}  // namespace reach
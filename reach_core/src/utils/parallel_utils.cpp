@@ -0,0 +1,225 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "reach_core/utils/parallel_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+/**
+ * @brief Range of chunk indices [begin, end) owned by a worker. The owner takes chunks from the front, and thieves
+ * take chunks from the back
+ */
+struct ChunkQueue
+{
+  std::mutex mutex;
+  std::size_t begin = 0;
+  std::size_t end = 0;
+};
+
+bool pop(ChunkQueue& queue, std::size_t& chunk)
+{
+  std::lock_guard<std::mutex> lock{ queue.mutex };
+  if (queue.begin < queue.end)
+  {
+    chunk = queue.begin++;
+    return true;
+  }
+  return false;
+}
+
+bool steal(std::vector<ChunkQueue>& queues, const std::size_t thief, std::size_t& chunk)
+{
+  for (std::size_t i = 1; i < queues.size(); ++i)
+  {
+    ChunkQueue& victim = queues[(thief + i) % queues.size()];
+
+    std::size_t begin, end;
+    {
+      std::lock_guard<std::mutex> lock{ victim.mutex };
+      if (victim.begin >= victim.end)
+        continue;
+
+      // Take the back half of the victim's remaining chunks
+      const std::size_t n_stolen = (victim.end - victim.begin + 1) / 2;
+      begin = victim.end - n_stolen;
+      end = victim.end;
+      victim.end = begin;
+    }
+
+    // Keep the first stolen chunk and make the rest available to this worker (and to other thieves)
+    ChunkQueue& own = queues[thief];
+    std::lock_guard<std::mutex> lock{ own.mutex };
+    own.begin = begin + 1;
+    own.end = end;
+    chunk = begin;
+    return true;
+  }
+
+  return false;
+}
+
+}  // namespace
+
+namespace reach
+{
+namespace utils
+{
+/**
+ * @brief State of a parallel loop, shared by its workers
+ */
+struct ThreadPool::Loop
+{
+  Loop(const std::size_t n_, const std::size_t grain_, const std::size_t n_workers,
+       const std::function<void(const std::size_t, const std::size_t)>& fn_)
+    : n(n_), grain(grain_), queues(n_workers), fn(fn_)
+  {
+  }
+
+  void work(const std::size_t worker)
+  {
+    try
+    {
+      std::size_t chunk;
+      while (!abort && (pop(queues[worker], chunk) || steal(queues, worker, chunk)))
+      {
+        const std::size_t last = std::min((chunk + 1) * grain, n);
+        for (std::size_t i = chunk * grain; i < last; ++i)
+        {
+          fn(i, worker);
+        }
+      }
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock{ error_mutex };
+      if (!error)
+        error = std::current_exception();
+      abort = true;
+    }
+  }
+
+  const std::size_t n;
+  const std::size_t grain;
+  std::vector<ChunkQueue> queues;
+  const std::function<void(const std::size_t, const std::size_t)>& fn;
+
+  std::atomic<bool> abort{ false };
+  std::exception_ptr error;
+  std::mutex error_mutex;
+};
+
+ThreadPool::ThreadPool(const std::size_t n_workers)
+{
+  const std::size_t n_threads = std::max<std::size_t>(n_workers, 1) - 1;
+  threads_.reserve(n_threads);
+  for (std::size_t i = 0; i < n_threads; ++i)
+  {
+    threads_.emplace_back(&ThreadPool::run, this, i + 1);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    stop_ = true;
+  }
+  start_.notify_all();
+
+  for (std::thread& t : threads_)
+  {
+    t.join();
+  }
+}
+
+void ThreadPool::run(const std::size_t worker)
+{
+  uint64_t generation = 0;
+  std::unique_lock<std::mutex> lock{ mutex_ };
+  while (true)
+  {
+    start_.wait(lock, [&] { return stop_ || generation_ != generation; });
+    if (stop_)
+      return;
+
+    generation = generation_;
+    if (worker >= n_active_)
+      continue;
+
+    Loop* loop = loop_;
+    lock.unlock();
+    loop->work(worker);
+    lock.lock();
+
+    if (--n_running_ == 0)
+      finish_.notify_all();
+  }
+}
+
+void ThreadPool::parallelFor(const std::size_t n, const std::size_t grain_size,
+                             const std::function<void(const std::size_t index, const std::size_t worker)>& fn)
+{
+  if (n == 0)
+    return;
+
+  std::lock_guard<std::mutex> loop_lock{ loop_mutex_ };
+
+  const std::size_t grain = std::max<std::size_t>(grain_size, 1);
+  const std::size_t n_chunks = (n + grain - 1) / grain;
+  const std::size_t n_workers = std::min(size(), n_chunks);
+
+  // Divide the chunks evenly between the workers
+  Loop loop(n, grain, n_workers, fn);
+  for (std::size_t i = 0; i < n_workers; ++i)
+  {
+    loop.queues[i].begin = (n_chunks * i) / n_workers;
+    loop.queues[i].end = (n_chunks * (i + 1)) / n_workers;
+  }
+
+  // Start the other workers, and work on the calling thread
+  if (n_workers > 1)
+  {
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      loop_ = &loop;
+      n_active_ = n_workers;
+      n_running_ = n_workers - 1;
+      ++generation_;
+    }
+    start_.notify_all();
+  }
+
+  loop.work(0);
+
+  if (n_workers > 1)
+  {
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    finish_.wait(lock, [&] { return n_running_ == 0; });
+    loop_ = nullptr;
+  }
+
+  if (loop.error)
+    std::rethrow_exception(loop.error);
+}
+
+}  // namespace utils
+}  // namespace reach
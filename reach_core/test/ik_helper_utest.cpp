@@ -0,0 +1,87 @@
+#include <reach_core/ik_helper.h>
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace reach::core;
+
+namespace
+{
+const double SPACING = 0.1;
+const double RADIUS = 0.15;
+
+/**
+ * @brief Solver that reaches every target up to the input x coordinate, moving the joint by one unit from the seed
+ */
+boost::shared_ptr<test::StubIKSolver> makeSolver(const double max_x)
+{
+  return boost::make_shared<test::StubIKSolver>(
+      [max_x](const Eigen::Isometry3d& target, const double seed, double& solution) -> boost::optional<double> {
+        if (target.translation().x() > max_x)
+          return {};
+
+        solution = seed + 1.0;
+        return 1.0;
+      });
+}
+
+/**
+ * @brief Database of reached points along the x axis
+ */
+ReachDatabasePtr makeLine(const std::size_t n)
+{
+  std::vector<std::size_t> reached(n);
+  std::iota(reached.begin(), reached.end(), 0);
+  return test::makeLine(n, SPACING, reached);
+}
+
+}  // namespace
+
+TEST(ReachNeighborsRecursive, ExpandsLargeRegionsWithoutRecursion)
+{
+  // A region far larger than the stack could hold if each point were reached by a recursive call
+  const std::size_t n = 20000;
+  const std::size_t n_reachable = 15001;
+  const ReachDatabasePtr db = makeLine(n);
+  const auto solver = makeSolver(SPACING * (n_reachable - 1) + 0.01);
+
+  reach::utils::ThreadPool pool(2);
+  auto graph = std::make_shared<NeighborGraph>();
+  graph->build(*db, RADIUS, M_PI, pool);
+
+  std::vector<bool> visited(n, false);
+  const NeighborReachResult result = reachNeighborsRecursive(db, *db->get(std::size_t(0)), solver, RADIUS, graph,
+                                                             &visited);
+  ASSERT_EQ(result.reached_pts.size(), n_reachable);
+  EXPECT_EQ(result.reached_pts.front(), "0");
+  EXPECT_DOUBLE_EQ(result.joint_distance, static_cast<double>(n_reachable - 1));
+
+  // The scratch space is cleared for the next call
+  EXPECT_TRUE(std::none_of(visited.begin(), visited.end(), [](const bool v) { return v; }));
+
+  // The same region is found from another point, with or without the graph
+  const NeighborReachResult from_middle = reachNeighborsRecursive(db, *db->get(std::size_t(100)), solver, RADIUS);
+  EXPECT_EQ(from_middle.reached_pts.size(), n_reachable);
+  EXPECT_EQ(from_middle.reached_pts.front(), "100");
+}
+
+TEST(ReachNeighborsRecursive, DoesNotExpandUnreachablePoints)
+{
+  const ReachDatabasePtr db = makeLine(100);
+  const auto solver = makeSolver(-1.0);
+
+  const NeighborReachResult result = reachNeighborsRecursive(db, *db->get(std::size_t(50)), solver, RADIUS);
+  ASSERT_EQ(result.reached_pts.size(), 1u);
+  EXPECT_EQ(result.reached_pts.front(), "50");
+  EXPECT_DOUBLE_EQ(result.joint_distance, 0.0);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
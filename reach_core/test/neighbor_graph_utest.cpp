@@ -0,0 +1,121 @@
+#include <reach_core/neighbor_graph.h>
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace reach::core;
+
+namespace
+{
+const double RADIUS = 0.05;
+const double MAX_ANGLE = M_PI / 2.0;
+
+std::vector<char> readBytes(const std::string& filename)
+{
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeBytes(const std::string& filename, const std::vector<char>& bytes)
+{
+  std::ofstream file(filename.c_str(), std::ios::binary | std::ios::trunc);
+  file.write(bytes.data(), bytes.size());
+}
+
+void expectSameGraph(const NeighborGraph& a, const NeighborGraph& b)
+{
+  ASSERT_EQ(a.size(), b.size());
+  ASSERT_EQ(a.numEdges(), b.numEdges());
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    const NeighborGraph::Range na = a.neighbors(i);
+    const NeighborGraph::Range nb = b.neighbors(i);
+    ASSERT_EQ(std::vector<uint32_t>(na.begin(), na.end()), std::vector<uint32_t>(nb.begin(), nb.end()))
+        << "record " << i;
+  }
+}
+
+/**
+ * @brief Builds the graph of the database and saves it, returning the name of the file
+ */
+std::string saveGraph(const ReachDatabase& db, NeighborGraph& graph)
+{
+  reach::utils::ThreadPool pool(2);
+  graph.build(db, RADIUS, MAX_ANGLE, pool);
+
+  const std::string filename = testing::TempDir() + "neighbor_graph_utest.bin";
+  EXPECT_TRUE(graph.save(filename));
+  return filename;
+}
+
+}  // namespace
+
+TEST(NeighborGraph, RoundTrip)
+{
+  const ReachDatabasePtr db = test::makeRandomDatabase(1000);
+  NeighborGraph graph;
+  const std::string filename = saveGraph(*db, graph);
+  ASSERT_GT(graph.numEdges(), 0u);
+
+  NeighborGraph loaded;
+  ASSERT_TRUE(loaded.load(filename, *db, RADIUS, MAX_ANGLE));
+  expectSameGraph(loaded, graph);
+  std::remove(filename.c_str());
+}
+
+TEST(NeighborGraph, RejectsDifferentParameters)
+{
+  const ReachDatabasePtr db = test::makeRandomDatabase(1000);
+  NeighborGraph graph;
+  const std::string filename = saveGraph(*db, graph);
+
+  NeighborGraph loaded;
+  EXPECT_FALSE(loaded.load(filename, *db, RADIUS * 1.5, MAX_ANGLE));
+  EXPECT_FALSE(loaded.load(filename, *db, RADIUS, MAX_ANGLE / 2.0));
+
+  // A graph built for other goal poses is stale, even if the number of records is the same
+  reach_msgs::ReachRecord moved = *db->get(std::size_t(500));
+  moved.goal.position.x += 0.01;
+  db->put(moved);
+  EXPECT_FALSE(loaded.load(filename, *db, RADIUS, MAX_ANGLE));
+
+  const ReachDatabasePtr smaller = test::makeRandomDatabase(999);
+  EXPECT_FALSE(loaded.load(filename, *smaller, RADIUS, MAX_ANGLE));
+  std::remove(filename.c_str());
+}
+
+TEST(NeighborGraph, RejectsCorruptFile)
+{
+  const ReachDatabasePtr db = test::makeRandomDatabase(1000);
+  NeighborGraph graph;
+  const std::string filename = saveGraph(*db, graph);
+  const std::vector<char> bytes = readBytes(filename);
+
+  // Flip a byte of the offsets, of the neighbors and of the checksum
+  for (const std::size_t position : { bytes.size() / 4, bytes.size() / 2, bytes.size() - 1 })
+  {
+    std::vector<char> corrupt = bytes;
+    corrupt[position] ^= 0x10;
+    writeBytes(filename, corrupt);
+
+    NeighborGraph loaded;
+    EXPECT_FALSE(loaded.load(filename, *db, RADIUS, MAX_ANGLE)) << "byte " << position;
+  }
+
+  // Truncated files are rejected
+  writeBytes(filename, std::vector<char>(bytes.begin(), bytes.begin() + bytes.size() / 2));
+  NeighborGraph loaded;
+  EXPECT_FALSE(loaded.load(filename, *db, RADIUS, MAX_ANGLE));
+  std::remove(filename.c_str());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,158 @@
+#include <reach_core/ik_helper.h>
+#include <reach_core/optimization.h>
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace reach::core;
+
+namespace
+{
+const double RADIUS = 0.25;
+
+/**
+ * @brief A target is reached only from seeds close to a target-specific joint position, and solutions seeded closer to
+ * that position score higher, such that the optimization can improve the solutions by seeding from neighbors
+ */
+boost::optional<double> solveNearTargetPosition(const Eigen::Isometry3d& target, const double seed, double& solution)
+{
+  const double q = 2.0 * std::sin(13.0 * target.translation().x() + 7.0 * target.translation().y());
+  const double distance = std::abs(seed - q);
+  if (distance > 1.0)
+    return {};
+
+  solution = q + 0.1 * (seed - q);
+  return 1.0 / (1.0 + distance);
+}
+
+/**
+ * @brief Runs the initial study and the optimization of a grid of points with the input number of workers, and saves
+ * the optimized database to the input file
+ */
+float runStudy(const std::size_t n_workers, const std::string& filename, const bool compact)
+{
+  const std::size_t side = 20;
+  auto db = std::make_shared<ReachDatabase>();
+  IKSolverPool solvers(boost::make_shared<test::StubIKSolver>(solveNearTargetPosition), n_workers);
+  reach::utils::ThreadPool pool(n_workers);
+
+  // Initial study from a zero seed; with several workers the records are put in the order in which they are solved
+  auto solve = [&](const std::size_t i, const std::size_t worker) {
+    const double x = 0.1 * static_cast<double>(i % side);
+    const double y = 0.1 * static_cast<double>(i / side);
+    Eigen::Isometry3d target = Eigen::Isometry3d::Identity();
+    target.translation() << x, y, 0.0;
+
+    std::vector<double> solution = { 0.0 };
+    const boost::optional<double> score = solvers.get(worker)->solveIKFromSeed(target, { { "j", 0.0 } }, solution);
+    db->put(test::makeTestRecord(i, x, y, static_cast<bool>(score), solution.front(), score ? *score : 0.0));
+  };
+  pool.parallelFor(side * side, 1, solve);
+  const float initial_score = db->getStudyResults().norm_total_pose_score;
+
+  StudyOptimization params;
+  params.max_steps = 10;
+  params.step_improvement_threshold = 0.0f;
+  params.radius = RADIUS;
+  params.max_neighbor_angle = M_PI;
+  params.seed = 7;
+
+  auto graph = std::make_shared<NeighborGraph>();
+  graph->build(*db, RADIUS, M_PI, pool);
+  const std::vector<std::vector<std::size_t>> groups = colorNeighborhoods(*graph);
+  optimizeReachDatabase(*db, groups, graph, solvers, pool, params, 1);
+
+  db->save(filename, compact);
+  return db->getStudyResults().norm_total_pose_score - initial_score;
+}
+
+std::string readFile(const std::string& filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+}  // namespace
+
+TEST(ColorNeighborhoods, GroupsDoNotOverlap)
+{
+  const ReachDatabasePtr db = test::makeRandomDatabase(2000);
+  reach::utils::ThreadPool pool(2);
+  NeighborGraph graph;
+  graph.build(*db, 0.05, M_PI, pool);
+
+  const std::vector<std::vector<std::size_t>> greedy = colorNeighborhoods(graph, 0);
+  const std::vector<std::vector<std::size_t>> groups = colorNeighborhoods(graph);
+
+  for (const std::vector<std::vector<std::size_t>>* partition : { &greedy, &groups })
+  {
+    // Every record is in exactly one group, and no record is a neighbor of two members of the same group (which
+    // includes the members themselves)
+    std::vector<int> group_of(db->size(), -1);
+    for (std::size_t g = 0; g < partition->size(); ++g)
+    {
+      ASSERT_FALSE((*partition)[g].empty());
+      for (const std::size_t idx : (*partition)[g])
+      {
+        ASSERT_EQ(group_of[idx], -1);
+        group_of[idx] = static_cast<int>(g);
+      }
+    }
+    ASSERT_EQ(std::count(group_of.begin(), group_of.end(), -1), 0);
+
+    for (std::size_t i = 0; i < db->size(); ++i)
+    {
+      std::vector<int> neighborhood_groups = { group_of[i] };
+      for (const uint32_t neighbor : graph.neighbors(i))
+        neighborhood_groups.push_back(group_of[neighbor]);
+      std::sort(neighborhood_groups.begin(), neighborhood_groups.end());
+      EXPECT_TRUE(std::adjacent_find(neighborhood_groups.begin(), neighborhood_groups.end()) ==
+                  neighborhood_groups.end())
+          << "record " << i;
+    }
+  }
+
+  // Merging the small groups leaves fewer groups with fewer members than the minimum
+  auto countSmall = [](const std::vector<std::vector<std::size_t>>& partition) {
+    return std::count_if(partition.begin(), partition.end(), [](const std::vector<std::size_t>& group) {
+      return group.size() < MIN_COLOR_GROUP_SIZE;
+    });
+  };
+  EXPECT_LE(groups.size(), greedy.size());
+  EXPECT_LT(countSmall(groups), countSmall(greedy));
+}
+
+TEST(Optimization, SavedResultsDoNotDependOnWorkers)
+{
+  for (const bool compact : { false, true })
+  {
+    const std::string reference_file = testing::TempDir() + "reach_optimization_1.db";
+    const float improvement = runStudy(1, reference_file, compact);
+    EXPECT_GT(improvement, 0.0f);
+
+    const std::string reference = readFile(reference_file);
+    ASSERT_FALSE(reference.empty());
+
+    for (const std::size_t n_workers : { 2, 4, 8 })
+    {
+      const std::string file = testing::TempDir() + "reach_optimization_" + std::to_string(n_workers) + ".db";
+      runStudy(n_workers, file, compact);
+      EXPECT_TRUE(readFile(file) == reference) << n_workers << " workers, compact: " << compact;
+      std::remove(file.c_str());
+    }
+    std::remove(reference_file.c_str());
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
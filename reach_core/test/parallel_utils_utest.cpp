@@ -0,0 +1,136 @@
+#include <reach_core/utils/parallel_utils.h>
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using reach::utils::ThreadPool;
+
+namespace
+{
+/**
+ * @brief Runs a loop over n indices and checks that every index was visited exactly once by a valid worker
+ */
+void checkCoverage(ThreadPool& pool, const std::size_t n, const std::size_t grain_size)
+{
+  std::vector<std::atomic<int>> counts(n);
+  for (std::atomic<int>& c : counts)
+    c = 0;
+
+  std::atomic<bool> valid_worker{ true };
+  pool.parallelFor(n, grain_size, [&](const std::size_t i, const std::size_t worker) {
+    if (worker >= pool.size())
+      valid_worker = false;
+    ++counts[i];
+  });
+
+  EXPECT_TRUE(valid_worker);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    ASSERT_EQ(counts[i], 1) << "index " << i << " with n = " << n << " and grain size " << grain_size;
+  }
+}
+
+}  // namespace
+
+TEST(ThreadPool, VisitsEveryIndexOnce)
+{
+  for (const std::size_t n_workers : { 1, 2, 3, 8 })
+  {
+    ThreadPool pool(n_workers);
+    EXPECT_EQ(pool.size(), n_workers);
+    for (const std::size_t n : { 0, 1, 2, 7, 64, 1000, 10007 })
+    {
+      for (const std::size_t grain_size : { 0, 1, 3, 64, 20000 })
+      {
+        checkCoverage(pool, n, grain_size);
+      }
+    }
+  }
+}
+
+TEST(ThreadPool, ZeroWorkersRunOnCallingThread)
+{
+  ThreadPool pool(0);
+  EXPECT_EQ(pool.size(), 1u);
+  checkCoverage(pool, 100, 1);
+}
+
+TEST(ThreadPool, ReusesWorkersAcrossLoops)
+{
+  ThreadPool pool(4);
+  std::atomic<std::size_t> sum{ 0 };
+  for (int loop = 0; loop < 2000; ++loop)
+  {
+    pool.parallelFor(17, 1, [&](const std::size_t i, const std::size_t) { sum += i; });
+  }
+  EXPECT_EQ(sum, 2000u * (16u * 17u / 2u));
+}
+
+TEST(ThreadPool, UsesAllWorkers)
+{
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> used(pool.size());
+  for (std::atomic<int>& u : used)
+    u = 0;
+
+  // Each index blocks until every worker has taken an index, which can only happen if all of the workers run
+  std::atomic<int> n_started{ 0 };
+  pool.parallelFor(pool.size(), 1, [&](const std::size_t, const std::size_t worker) {
+    ++used[worker];
+    ++n_started;
+    while (n_started < static_cast<int>(pool.size()))
+      std::this_thread::yield();
+  });
+
+  for (std::atomic<int>& u : used)
+    EXPECT_EQ(u, 1);
+}
+
+TEST(ThreadPool, PropagatesExceptions)
+{
+  ThreadPool pool(4);
+  for (const std::size_t throwing_index : { 0, 1, 500, 999 })
+  {
+    std::atomic<std::size_t> n_calls{ 0 };
+    auto fn = [&](const std::size_t i, const std::size_t) {
+      ++n_calls;
+      if (i == throwing_index)
+        throw std::runtime_error("failure");
+    };
+    EXPECT_THROW(pool.parallelFor(1000, 1, fn), std::runtime_error);
+    EXPECT_LE(n_calls, 1000u);
+
+    // The pool remains usable after a loop throws
+    checkCoverage(pool, 1000, 1);
+  }
+}
+
+TEST(ThreadPool, RunsLoopsFromDifferentThreads)
+{
+  ThreadPool pool(4);
+  auto loop = [&](std::size_t& sum) {
+    for (int k = 0; k < 200; ++k)
+    {
+      std::atomic<std::size_t> loop_sum{ 0 };
+      pool.parallelFor(64, 1, [&](const std::size_t i, const std::size_t) { loop_sum += i; });
+      sum += loop_sum;
+    }
+  };
+
+  std::size_t sum_a = 0, sum_b = 0;
+  std::thread other(loop, std::ref(sum_a));
+  loop(sum_b);
+  other.join();
+  EXPECT_EQ(sum_a, 200u * (63u * 64u / 2u));
+  EXPECT_EQ(sum_b, 200u * (63u * 64u / 2u));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
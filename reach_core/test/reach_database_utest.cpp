@@ -0,0 +1,515 @@
+#include <reach_core/reach_database.h>
+#include <reach_core/reach_database_file.h>
+
+#include <gtest/gtest.h>
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace reach::core;
+
+namespace
+{
+reach_msgs::ReachRecord makeTestRecord(const std::size_t i)
+{
+  geometry_msgs::Pose goal;
+  goal.position.x = 0.01 * static_cast<double>(i);
+  goal.position.y = std::sin(static_cast<double>(i));
+  goal.orientation.w = 1.0;
+
+  sensor_msgs::JointState seed;
+  seed.name = { "a", "b" };
+  seed.position = { 0.0, 0.0 };
+  sensor_msgs::JointState state(seed);
+  state.position = { 0.1 * static_cast<double>(i), -0.2 * static_cast<double>(i) };
+
+  const bool reached = i % 3 != 0;
+  const double score = reached ? 0.5 + 0.001 * static_cast<double>(i) : 0.0;
+  return makeRecord(std::to_string(i), reached, goal, seed, state, score);
+}
+
+void expectSameRecord(const reach_msgs::ReachRecord& a, const reach_msgs::ReachRecord& b)
+{
+  EXPECT_EQ(a.id, b.id);
+  EXPECT_EQ(a.reached, b.reached);
+  EXPECT_EQ(a.score, b.score);
+  EXPECT_EQ(a.goal.position.x, b.goal.position.x);
+  EXPECT_EQ(a.goal.position.y, b.goal.position.y);
+  EXPECT_EQ(a.goal.position.z, b.goal.position.z);
+  EXPECT_EQ(a.goal.orientation.w, b.goal.orientation.w);
+  EXPECT_EQ(a.seed_state.name, b.seed_state.name);
+  EXPECT_EQ(a.seed_state.position, b.seed_state.position);
+  EXPECT_EQ(a.goal_state.name, b.goal_state.name);
+  EXPECT_EQ(a.goal_state.position, b.goal_state.position);
+}
+
+bool fileExists(const std::string& filename)
+{
+  return std::ifstream(filename.c_str()).good();
+}
+
+std::vector<char> readBytes(const std::string& filename)
+{
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeBytes(const std::string& filename, const std::vector<char>& bytes)
+{
+  std::ofstream file(filename.c_str(), std::ios::binary | std::ios::trunc);
+  file.write(bytes.data(), bytes.size());
+}
+
+/**
+ * @brief Layout of the header of a columnar database file (see reach_database_file.cpp)
+ */
+const std::size_t VERSION_OFFSET = 8;
+const std::size_t N_COLUMNS_OFFSET = 12;
+const std::size_t CHUNK_SIZE_OFFSET = 52;
+const std::size_t COLUMNS_OFFSET = 56;
+const uint32_t SEED_POSITIONS = 5;
+const uint32_t GOAL_POSITIONS = 6;
+const uint32_t ID_OFFSETS = 7;
+const uint32_t CHECKSUMS = 10;
+
+template <typename T>
+T getValue(const std::vector<char>& bytes, const std::size_t offset)
+{
+  T value;
+  std::memcpy(&value, bytes.data() + offset, sizeof(T));
+  return value;
+}
+
+template <typename T>
+void setValue(std::vector<char>& bytes, const std::size_t offset, const T value)
+{
+  std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+uint64_t columnOffset(const std::vector<char>& bytes, const uint32_t column)
+{
+  return getValue<uint64_t>(bytes, COLUMNS_OFFSET + 16 * column);
+}
+
+uint64_t columnSize(const std::vector<char>& bytes, const uint32_t column)
+{
+  return getValue<uint64_t>(bytes, COLUMNS_OFFSET + 16 * column + 8);
+}
+
+/**
+ * @brief Recomputes the checksums of a file of version 2 or later after its columns were modified, such that only the
+ * consistency checks can detect the modification
+ */
+void updateChecksums(std::vector<char>& bytes)
+{
+  const uint32_t chunk_size = getValue<uint32_t>(bytes, CHUNK_SIZE_OFFSET);
+  std::size_t chunk = 0;
+  for (uint32_t c = 0; c < CHECKSUMS; ++c)
+  {
+    const uint64_t offset = columnOffset(bytes, c);
+    const uint64_t size = columnSize(bytes, c);
+    for (uint64_t begin = 0; begin < size; begin += chunk_size, ++chunk)
+    {
+      boost::crc_32_type crc;
+      crc.process_bytes(bytes.data() + offset + begin, std::min<uint64_t>(chunk_size, size - begin));
+      setValue<uint32_t>(bytes, columnOffset(bytes, CHECKSUMS) + chunk * sizeof(uint32_t), crc.checksum());
+    }
+  }
+}
+
+/**
+ * @brief Database of records with IDs 0 to n - 1, except for the IDs ending in 5, which are left empty
+ */
+ReachDatabasePtr makeDatabase(const std::size_t n)
+{
+  auto db = std::make_shared<ReachDatabase>();
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    if (i % 10 != 5)
+      db->put(makeTestRecord(i));
+  }
+  return db;
+}
+
+/**
+ * @brief Saves a database of 150 records (three blocks of the compact encoding) and returns the name of the file
+ */
+std::string saveDatabase(const bool compact)
+{
+  const std::string name = compact ? "reach_database_utest_compact.db" : "reach_database_utest.db";
+  const std::string filename = testing::TempDir() + name;
+  makeDatabase(150)->save(filename, compact);
+  return filename;
+}
+
+bool loads(const std::string& filename)
+{
+  ReachDatabase db;
+  return db.load(filename);
+}
+
+}  // namespace
+
+TEST(ReachDatabaseResults, DoNotDependOnUpdateOrder)
+{
+  // Put the same records in opposite orders, replacing each one several times
+  const std::size_t n = 500;
+  ReachDatabase forward;
+  ReachDatabase backward;
+  for (int pass = 0; pass < 3; ++pass)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      reach_msgs::ReachRecord record = makeTestRecord(i);
+      record.score *= 1.0 + 0.1 * pass;
+      forward.put(record);
+
+      reach_msgs::ReachRecord reverse_record = makeTestRecord(n - 1 - i);
+      reverse_record.score *= 1.0 + 0.1 * pass;
+      backward.put(reverse_record);
+    }
+  }
+
+  double expected = 0.0;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const reach_msgs::ReachRecord record = makeTestRecord(i);
+    if (record.reached)
+      expected += 1.2 * record.score;
+  }
+
+  const StudyResults results = forward.getStudyResults();
+  EXPECT_EQ(results.total_pose_score, backward.getStudyResults().total_pose_score);
+  EXPECT_EQ(results.norm_total_pose_score, backward.getStudyResults().norm_total_pose_score);
+  EXPECT_NEAR(results.total_pose_score, expected, 1.0e-3);
+  EXPECT_FLOAT_EQ(results.reach_percentage, 100.0f * 333.0f / 500.0f);
+}
+
+TEST(ReachDatabaseCheckpoint, ResumesMatchingStudy)
+{
+  const std::string filename = testing::TempDir() + "reach_database_utest.checkpoint";
+  std::remove(filename.c_str());
+
+  ReachDatabase db;
+  for (std::size_t i = 0; i < 10; ++i)
+  {
+    db.put(makeTestRecord(i));
+    if (i % 4 == 3)
+      ASSERT_TRUE(db.checkpoint(filename, 20, 1234));
+  }
+  ASSERT_TRUE(db.checkpoint(filename, 20, 1234));
+
+  ReachDatabase resumed;
+  ASSERT_TRUE(resumed.loadCheckpoint(filename, 20, 1234));
+  ASSERT_EQ(resumed.size(), 10u);
+  for (std::size_t i = 0; i < 10; ++i)
+  {
+    const boost::optional<reach_msgs::ReachRecord> rec = resumed.get(i);
+    ASSERT_TRUE(rec);
+    expectSameRecord(*rec, *db.get(i));
+  }
+  std::remove(filename.c_str());
+}
+
+TEST(ReachDatabaseCheckpoint, RemovesPartialRecord)
+{
+  const std::string filename = testing::TempDir() + "reach_database_utest.checkpoint";
+  std::remove(filename.c_str());
+
+  ReachDatabase db;
+  for (std::size_t i = 0; i < 6; ++i)
+    db.put(makeTestRecord(i));
+  ASSERT_TRUE(db.checkpoint(filename, 20, 1234));
+  const std::size_t complete_size = readBytes(filename).size();
+
+  // A crash while appending record 6 leaves part of it at the end of the file
+  db.put(makeTestRecord(6));
+  ASSERT_TRUE(db.checkpoint(filename, 20, 1234));
+  std::vector<char> bytes = readBytes(filename);
+  bytes.resize(bytes.size() - 5);
+  writeBytes(filename, bytes);
+
+  ReachDatabase resumed;
+  ASSERT_TRUE(resumed.loadCheckpoint(filename, 20, 1234));
+  EXPECT_EQ(readBytes(filename).size(), complete_size);
+  EXPECT_FALSE(resumed.get(std::size_t(6)));
+
+  // Records checkpointed after resuming can be read again
+  resumed.put(makeTestRecord(7));
+  resumed.put(makeTestRecord(8));
+  ASSERT_TRUE(resumed.checkpoint(filename, 20, 1234));
+
+  // A corrupt length must not be trusted with an allocation
+  bytes = readBytes(filename);
+  const std::size_t appended_size = bytes.size();
+  const uint32_t corrupt_length = 0xfffffff0u;
+  bytes.insert(bytes.end(), reinterpret_cast<const char*>(&corrupt_length),
+               reinterpret_cast<const char*>(&corrupt_length) + sizeof(corrupt_length));
+  bytes.insert(bytes.end(), 16, 'x');
+  writeBytes(filename, bytes);
+
+  ReachDatabase resumed_again;
+  ASSERT_TRUE(resumed_again.loadCheckpoint(filename, 20, 1234));
+  EXPECT_EQ(readBytes(filename).size(), appended_size);
+  for (const std::size_t i : { 0, 1, 2, 3, 4, 5, 7, 8 })
+  {
+    const boost::optional<reach_msgs::ReachRecord> rec = resumed_again.get(i);
+    ASSERT_TRUE(rec) << "record " << i;
+    expectSameRecord(*rec, makeTestRecord(i));
+  }
+  EXPECT_FALSE(resumed_again.get(std::size_t(6)));
+  std::remove(filename.c_str());
+}
+
+TEST(ReachDatabaseCheckpoint, DiscardsStaleCheckpoint)
+{
+  const std::string filename = testing::TempDir() + "reach_database_utest.checkpoint";
+  std::remove(filename.c_str());
+
+  ReachDatabase db;
+  db.put(makeTestRecord(1));
+  ASSERT_TRUE(db.checkpoint(filename, 20, 1234));
+
+  // A different number of points or a different checksum identifies a different study
+  ReachDatabase other_size;
+  EXPECT_FALSE(other_size.loadCheckpoint(filename, 21, 1234));
+  EXPECT_EQ(other_size.size(), 0u);
+  EXPECT_FALSE(fileExists(filename));
+
+  ASSERT_TRUE(db.checkpoint(filename, 20, 1234));
+  ReachDatabase other_checksum;
+  EXPECT_FALSE(other_checksum.loadCheckpoint(filename, 20, 4321));
+  EXPECT_EQ(other_checksum.size(), 0u);
+  EXPECT_FALSE(fileExists(filename));
+
+  // Checkpoints without a header were written before studies were identified
+  {
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    file << "not a checkpoint";
+  }
+  ReachDatabase headerless;
+  EXPECT_FALSE(headerless.loadCheckpoint(filename, 20, 1234));
+  EXPECT_FALSE(fileExists(filename));
+}
+
+TEST(ReachDatabaseFile, RoundTrip)
+{
+  const ReachDatabasePtr db = makeDatabase(150);
+  const std::string filename = saveDatabase(false);
+
+  ReachDatabase loaded;
+  ASSERT_TRUE(loaded.load(filename));
+  ASSERT_EQ(loaded.size(), db->size());
+  for (std::size_t i = 0; i < db->size(); ++i)
+  {
+    ASSERT_EQ(static_cast<bool>(loaded.get(i)), static_cast<bool>(db->get(i)));
+    if (db->get(i))
+      expectSameRecord(*loaded.get(i), *db->get(i));
+  }
+  EXPECT_EQ(loaded.getStudyResults().total_pose_score, db->getStudyResults().total_pose_score);
+  std::remove(filename.c_str());
+}
+
+TEST(ReachDatabaseFile, SaveFailureKeepsPreviousFile)
+{
+  const std::string filename = saveDatabase(false);
+  const std::vector<char> previous = readBytes(filename);
+
+  // The temporary file cannot be created where a directory of the same name exists
+  const std::string tmp_filename = filename + ".tmp";
+  ASSERT_TRUE(boost::filesystem::create_directory(tmp_filename));
+  EXPECT_THROW(makeDatabase(10)->save(filename), std::runtime_error);
+  EXPECT_TRUE(readBytes(filename) == previous);
+  EXPECT_TRUE(loads(filename));
+  boost::filesystem::remove(tmp_filename);
+
+  // Saving replaces the file without leaving the temporary file behind
+  makeDatabase(10)->save(filename);
+  EXPECT_FALSE(fileExists(tmp_filename));
+  ReachDatabase loaded;
+  ASSERT_TRUE(loaded.load(filename));
+  EXPECT_EQ(loaded.size(), 10u);
+  std::remove(filename.c_str());
+}
+
+TEST(ReachDatabaseFile, SavesDifferentJointsInLegacyFormat)
+{
+  const ReachDatabasePtr db = makeDatabase(20);
+  reach_msgs::ReachRecord record = *db->get(std::size_t(6));
+  record.seed_state.name = { "c" };
+  record.seed_state.position = { 1.0 };
+  record.goal_state = record.seed_state;
+  db->put(record);
+
+  const std::string filename = testing::TempDir() + "reach_database_utest_legacy.db";
+  db->save(filename);
+  EXPECT_FALSE(isColumnarDatabaseFile(filename));
+
+  ReachDatabase loaded;
+  ASSERT_TRUE(loaded.load(filename));
+  ASSERT_TRUE(loaded.get(std::size_t(6)));
+  expectSameRecord(*loaded.get(std::size_t(6)), record);
+  std::remove(filename.c_str());
+}
+
+TEST(ReachDatabaseFile, CompactEncodingAccuracy)
+{
+  const ReachDatabasePtr db = makeDatabase(150);
+  const std::string filename = saveDatabase(true);
+
+  MappedReachDatabase file;
+  ASSERT_TRUE(file.open(filename));
+  ASSERT_TRUE(file.verify());
+  EXPECT_TRUE(file.isCompact());
+  ASSERT_EQ(file.size(), db->size());
+
+  for (std::size_t i = 0; i < db->size(); ++i)
+  {
+    const boost::optional<reach_msgs::ReachRecord> expected = db->get(i);
+    ASSERT_EQ(file.contains(i), static_cast<bool>(expected));
+    if (!expected)
+      continue;
+
+    const reach_msgs::ReachRecord rec = file.record(i);
+    EXPECT_EQ(rec.id, expected->id);
+    EXPECT_EQ(rec.reached, expected->reached);
+
+    // Scores share an exponent per block and keep 31 bits of the largest score of the block
+    EXPECT_NEAR(rec.score, expected->score, 1.0e-9);
+    EXPECT_FLOAT_EQ(rec.goal.position.x, expected->goal.position.x);
+    EXPECT_FLOAT_EQ(rec.goal.position.y, expected->goal.position.y);
+    EXPECT_FLOAT_EQ(rec.goal.orientation.w, expected->goal.orientation.w);
+
+    // Joint positions are quantized to 1e-6, and goal positions relative to the quantized seed positions
+    ASSERT_EQ(rec.goal_state.position.size(), expected->goal_state.position.size());
+    for (std::size_t j = 0; j < rec.goal_state.position.size(); ++j)
+    {
+      EXPECT_NEAR(rec.seed_state.position[j], expected->seed_state.position[j], 0.5e-6 + 1.0e-12);
+      EXPECT_NEAR(rec.goal_state.position[j], expected->goal_state.position[j], 0.5e-6 + 1.0e-12);
+    }
+  }
+  file.close();
+  std::remove(filename.c_str());
+}
+
+TEST(ReachDatabaseFile, ReadsOlderVersions)
+{
+  const std::string filename = saveDatabase(false);
+  const std::vector<char> bytes = readBytes(filename);
+
+  // A raw version 3 file differs from a version 2 file only in its version, and from a version 1 file also in the
+  // number of columns, since the columns added since are ignored by older readers
+  std::vector<char> v2 = bytes;
+  setValue<uint32_t>(v2, VERSION_OFFSET, 2);
+  std::vector<char> v1 = v2;
+  setValue<uint32_t>(v1, VERSION_OFFSET, 1);
+  setValue<uint32_t>(v1, N_COLUMNS_OFFSET, CHECKSUMS);
+
+  for (const std::vector<char>& version : { v1, v2 })
+  {
+    writeBytes(filename, version);
+    ReachDatabase loaded;
+    ASSERT_TRUE(loaded.load(filename));
+    EXPECT_EQ(loaded.size(), 150u);
+    expectSameRecord(*loaded.get(42), makeTestRecord(42));
+  }
+  std::remove(filename.c_str());
+}
+
+TEST(ReachDatabaseFile, RejectsChecksumMismatch)
+{
+  for (const bool compact : { false, true })
+  {
+    const std::string filename = saveDatabase(compact);
+    std::vector<char> bytes = readBytes(filename);
+    for (const uint32_t version : { 2, 3 })
+    {
+      if (compact && version == 2)
+        continue;
+
+      std::vector<char> corrupt = bytes;
+      setValue<uint32_t>(corrupt, VERSION_OFFSET, version);
+      corrupt[columnOffset(corrupt, SEED_POSITIONS) + 3] ^= 0x10;
+      writeBytes(filename, corrupt);
+
+      MappedReachDatabase file;
+      ASSERT_TRUE(file.open(filename));
+      EXPECT_FALSE(file.verify());
+      file.close();
+      EXPECT_FALSE(loads(filename));
+    }
+    std::remove(filename.c_str());
+  }
+}
+
+TEST(ReachDatabaseFile, RejectsInvalidIDOffsets)
+{
+  const std::string filename = saveDatabase(false);
+  std::vector<char> bytes = readBytes(filename);
+
+  // Version 1 files have no checksums, so only the consistency checks detect the corruption
+  setValue<uint32_t>(bytes, VERSION_OFFSET, 1);
+  setValue<uint32_t>(bytes, N_COLUMNS_OFFSET, CHECKSUMS);
+  const uint64_t offsets = columnOffset(bytes, ID_OFFSETS);
+  const uint64_t later_offset = getValue<uint64_t>(bytes, offsets + 12 * sizeof(uint64_t));
+  setValue<uint64_t>(bytes, offsets + 10 * sizeof(uint64_t), later_offset);
+  writeBytes(filename, bytes);
+
+  EXPECT_FALSE(loads(filename));
+  std::remove(filename.c_str());
+}
+
+TEST(ReachDatabaseFile, RejectsInvalidJointBlocks)
+{
+  const std::string filename = saveDatabase(true);
+  const std::vector<char> bytes = readBytes(filename);
+  ASSERT_TRUE(loads(filename));
+
+  const uint64_t column = columnOffset(bytes, GOAL_POSITIONS);
+  const uint64_t block_offsets = column + columnSize(bytes, GOAL_POSITIONS) - 3 * sizeof(uint64_t);
+  const uint64_t block_1 = getValue<uint64_t>(bytes, block_offsets + sizeof(uint64_t));
+
+  // Offset of a block past the end of the column
+  std::vector<char> out_of_range = bytes;
+  setValue<uint64_t>(out_of_range, block_offsets + sizeof(uint64_t), columnSize(bytes, GOAL_POSITIONS));
+
+  // Offsets that are not increasing
+  std::vector<char> decreasing = bytes;
+  setValue<uint64_t>(decreasing, block_offsets + 2 * sizeof(uint64_t), block_1 - 1);
+
+  // The last integer of the first block continues into the second block
+  std::vector<char> continued = bytes;
+  continued[column + block_1 - 1] |= static_cast<char>(0x80);
+
+  // The last integer of the column is truncated
+  std::vector<char> truncated = bytes;
+  const uint64_t seed_column = columnOffset(bytes, SEED_POSITIONS);
+  const uint64_t seed_end = seed_column + columnSize(bytes, SEED_POSITIONS) - 3 * sizeof(uint64_t);
+  for (uint64_t i = seed_column + getValue<uint64_t>(bytes, seed_end + 2 * sizeof(uint64_t)); i < seed_end; ++i)
+    truncated[i] |= static_cast<char>(0x80);
+
+  for (std::vector<char>* corrupt : { &out_of_range, &decreasing, &continued, &truncated })
+  {
+    updateChecksums(*corrupt);
+    writeBytes(filename, *corrupt);
+
+    MappedReachDatabase file;
+    ASSERT_TRUE(file.open(filename));
+    EXPECT_FALSE(file.verify());
+    file.close();
+    EXPECT_FALSE(loads(filename));
+  }
+  std::remove(filename.c_str());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,119 @@
+#include <reach_core/region_analysis.h>
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace reach::core;
+
+namespace
+{
+const double SPACING = 1.0;
+const double RADIUS = 1.1;
+
+/**
+ * @brief A target is reached if the seed is within one unit of its x coordinate, which is the ideal joint value, and
+ * the solution is pulled from the ideal value towards the seed by the input fraction
+ */
+test::StubIKSolver::SolveFunction pullTowardsSeed(const double pull)
+{
+  return [pull](const Eigen::Isometry3d& target, const double seed, double& solution) -> boost::optional<double> {
+    const double x = target.translation().x();
+    if (std::abs(seed - x) > 1.0 + 1.0e-9)
+      return {};
+
+    solution = x + pull * (seed - x);
+    return 1.0;
+  };
+}
+
+ReachDatabasePtr makeLine(const std::size_t n, const std::vector<std::size_t>& reached)
+{
+  return test::makeLine(n, SPACING, reached);
+}
+
+RegionAnalysisResult analyze(const ReachDatabase& db, const double pull, const std::size_t n_workers)
+{
+  IKSolverPool solvers(boost::make_shared<test::StubIKSolver>(pullTowardsSeed(pull)), n_workers);
+  reach::utils::ThreadPool pool(n_workers);
+  NeighborGraph graph;
+  graph.build(db, RADIUS, M_PI, pool);
+  return analyzeRegions(db, graph, solvers, pool, 1);
+}
+
+}  // namespace
+
+TEST(RegionAnalysis, ExpandsPointsMovedTo)
+{
+  // Only the first point was reached by the study, but the robot can move along the whole line from it
+  const ReachDatabasePtr db = makeLine(5, { 0 });
+  const RegionAnalysisResult result = analyze(*db, 0.0, 2);
+
+  ASSERT_EQ(result.region_sizes.size(), 1u);
+  EXPECT_EQ(result.region_sizes.front(), 5u);
+  for (std::size_t i = 0; i < 5; ++i)
+    EXPECT_EQ(result.regions[i], 0);
+
+  EXPECT_EQ(result.n_moves, 4u);
+  EXPECT_DOUBLE_EQ(result.avg_joint_distance, SPACING);
+  EXPECT_DOUBLE_EQ(result.avg_num_neighbors, 4.0 / 5.0);
+}
+
+TEST(RegionAnalysis, DoesNotMergeThroughDifferentArrivals)
+{
+  // Points 0 and 2 were reached, and both can move to point 1. With the solution of the move from point 0, point 1
+  // cannot move on to point 2, so the regions of points 0 and 2 must not be merged through point 1
+  const ReachDatabasePtr db = makeLine(3, { 0, 2 });
+  const RegionAnalysisResult result = analyze(*db, 0.5, 2);
+
+  ASSERT_EQ(result.region_sizes.size(), 2u);
+  EXPECT_EQ(result.region_sizes[0], 2u);
+  EXPECT_EQ(result.region_sizes[1], 1u);
+  EXPECT_EQ(result.regions[0], result.regions[1]);
+  EXPECT_NE(result.regions[0], result.regions[2]);
+}
+
+TEST(RegionAnalysis, SkipsUnreachedPointsThatCannotBeMovedTo)
+{
+  // Point 2 is the only one reached; with a pull of 0.5 the robot reaches its neighbors but cannot continue further
+  const ReachDatabasePtr db = makeLine(5, { 2 });
+  const RegionAnalysisResult result = analyze(*db, 0.5, 1);
+
+  ASSERT_EQ(result.region_sizes.size(), 1u);
+  EXPECT_EQ(result.region_sizes.front(), 3u);
+  EXPECT_EQ(result.regions[0], -1);
+  EXPECT_EQ(result.regions[4], -1);
+}
+
+TEST(RegionAnalysis, ResultsDoNotDependOnWorkers)
+{
+  const std::size_t n = 200;
+  std::vector<std::size_t> reached;
+  for (std::size_t i = 0; i < n; i += 7)
+    reached.push_back(i);
+  const ReachDatabasePtr db = makeLine(n, reached);
+
+  for (const double pull : { 0.0, 0.3 })
+  {
+    const RegionAnalysisResult reference = analyze(*db, pull, 1);
+    for (const std::size_t n_workers : { 2, 4, 8 })
+    {
+      const RegionAnalysisResult result = analyze(*db, pull, n_workers);
+      EXPECT_EQ(result.region_sizes, reference.region_sizes);
+      EXPECT_EQ(result.regions, reference.regions);
+      EXPECT_EQ(result.n_attempts, reference.n_attempts);
+      EXPECT_EQ(result.n_moves, reference.n_moves);
+      EXPECT_EQ(result.avg_joint_distance, reference.avg_joint_distance);
+      EXPECT_EQ(result.avg_num_neighbors, reference.avg_num_neighbors);
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
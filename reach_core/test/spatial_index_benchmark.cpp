@@ -0,0 +1,120 @@
+/*
+ * Copyright 2019 Southwest Research Institute
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <reach_core/spatial_index.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace
+{
+/**
+ * @brief Samples points uniformly from the surface of a box, similar to the points sampled from the mesh of a reach
+ * object
+ */
+std::vector<Eigen::Vector3f> sampleBoxSurface(const std::size_t n, const Eigen::Vector3f& size)
+{
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+  const float areas[3] = { size.y() * size.z(), size.x() * size.z(), size.x() * size.y() };
+  std::discrete_distribution<int> face_axis({ areas[0], areas[1], areas[2] });
+
+  std::vector<Eigen::Vector3f> points(n);
+  for (Eigen::Vector3f& pt : points)
+  {
+    // Pick a face with probability proportional to its area, then a point on the face
+    const int axis = face_axis(rng);
+    pt = Eigen::Vector3f(uniform(rng), uniform(rng), uniform(rng)).cwiseProduct(size);
+    pt[axis] = uniform(rng) < 0.5f ? 0.0f : size[axis];
+  }
+  return points;
+}
+
+double secondsSince(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+/**
+ * Compares the time taken to build and to query the spatial index types with the PCL KD-tree, using a radius search
+ * around every point of a uniformly sampled surface
+ */
+int main(int argc, char** argv)
+{
+  if (argc > 3)
+  {
+    std::cout << "Usage: spatial_index_benchmark [n_points] [radius]" << std::endl;
+    return -1;
+  }
+
+  const std::size_t n = argc > 1 ? std::stoul(argv[1]) : 20000;
+  const double radius = argc > 2 ? std::stod(argv[2]) : 0.05;
+  const std::vector<Eigen::Vector3f> points = sampleBoxSurface(n, Eigen::Vector3f(1.0f, 0.5f, 0.2f));
+  std::cout << "Searching " << n << " points with radius " << radius << std::endl;
+
+  // PCL KD-tree, queried directly
+  {
+    auto start = std::chrono::steady_clock::now();
+    auto cloud = pcl::make_shared<pcl::PointCloud<pcl::PointXYZ>>();
+    for (const Eigen::Vector3f& pt : points)
+    {
+      cloud->push_back(pcl::PointXYZ(pt.x(), pt.y(), pt.z()));
+    }
+    pcl::search::KdTree<pcl::PointXYZ> tree;
+    tree.setInputCloud(cloud);
+    const double build_time = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    std::size_t n_found = 0;
+    std::vector<int> indices;
+    std::vector<float> distances;
+    for (const pcl::PointXYZ& pt : cloud->points)
+    {
+      n_found += tree.radiusSearch(pt, radius, indices, distances);
+    }
+    const double query_time = secondsSince(start);
+
+    std::cout << "pcl::search::KdTree: build " << build_time << " s, query " << query_time / n * 1.0e6 << " us, "
+              << static_cast<double>(n_found) / n << " neighbors" << std::endl;
+  }
+
+  for (const std::string& name : { "kdtree", "brute_force", "voxel_grid" })
+  {
+    const reach::core::SpatialIndexPtr index = reach::core::getSpatialIndexFactory(name, radius)(n);
+
+    auto start = std::chrono::steady_clock::now();
+    index->build(points);
+    const double build_time = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    std::size_t n_found = 0;
+    std::vector<std::size_t> indices;
+    for (const Eigen::Vector3f& pt : points)
+    {
+      index->radiusSearch(pt, radius, indices);
+      n_found += indices.size();
+    }
+    const double query_time = secondsSince(start);
+
+    std::cout << name << ": build " << build_time << " s, query " << query_time / n * 1.0e6 << " us, "
+              << static_cast<double>(n_found) / n << " neighbors" << std::endl;
+  }
+
+  return 0;
+}
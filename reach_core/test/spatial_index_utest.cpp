@@ -0,0 +1,197 @@
+#include <reach_core/spatial_index.h>
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace reach::core;
+
+namespace
+{
+const double RADIUS = 0.05;
+
+/**
+ * @brief Samples points uniformly from the surface of a box, plus some duplicates of the sampled points, with their
+ * outward normals as directions
+ */
+void sampleBoxSurface(const std::size_t n, std::vector<Eigen::Vector3f>& points, std::vector<Eigen::Vector3f>& normals)
+{
+  const Eigen::Vector3f size(1.0f, 0.5f, 0.2f);
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  std::uniform_int_distribution<int> face_axis(0, 2);
+
+  points.resize(n);
+  normals.resize(n);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const int axis = face_axis(rng);
+    const bool upper = uniform(rng) < 0.5f;
+    points[i] = Eigen::Vector3f(uniform(rng), uniform(rng), uniform(rng)).cwiseProduct(size);
+    points[i][axis] = upper ? size[axis] : 0.0f;
+    normals[i] = Eigen::Vector3f::Zero();
+    normals[i][axis] = upper ? 1.0f : -1.0f;
+  }
+
+  // Coincident points must all be found
+  for (std::size_t i = 0; i < n / 10; ++i)
+  {
+    points.push_back(points[i * 7 % n]);
+    normals.push_back(normals[i * 7 % n]);
+  }
+}
+
+std::vector<std::size_t> radiusSearch(const SpatialIndex& index, const Eigen::Vector3f& query, const double radius)
+{
+  std::vector<std::size_t> indices;
+  index.radiusSearch(query, radius, indices);
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+
+/**
+ * @brief Returns the distances of the points of the nearest k search, which (unlike the indices) do not depend on how
+ * ties are broken
+ */
+std::vector<float> nearestKDistances(const SpatialIndex& index, const std::vector<Eigen::Vector3f>& points,
+                                     const Eigen::Vector3f& query, const std::size_t k)
+{
+  std::vector<std::size_t> indices;
+  index.nearestKSearch(query, k, indices);
+  std::vector<float> distances;
+  for (const std::size_t i : indices)
+    distances.push_back((points[i] - query).norm());
+  return distances;
+}
+
+/**
+ * @brief Returns the types of index to compare with the brute-force index, including voxel grids whose cells are
+ * smaller and larger than the search radius
+ */
+std::vector<std::pair<std::string, SpatialIndexPtr>> makeIndices()
+{
+  return { { "kdtree", std::make_shared<KdTreeIndex>() },
+           { "voxel_grid", std::make_shared<VoxelGridIndex>(RADIUS) },
+           { "voxel_grid_small", std::make_shared<VoxelGridIndex>(RADIUS / 3.0) },
+           { "voxel_grid_large", std::make_shared<VoxelGridIndex>(RADIUS * 4.0) } };
+}
+
+}  // namespace
+
+TEST(SpatialIndex, RadiusSearchesAgree)
+{
+  std::vector<Eigen::Vector3f> points;
+  std::vector<Eigen::Vector3f> normals;
+  sampleBoxSurface(3000, points, normals);
+
+  BruteForceIndex reference;
+  reference.build(points);
+  for (const auto& index : makeIndices())
+  {
+    index.second->build(points);
+    for (std::size_t i = 0; i < points.size(); i += 3)
+    {
+      for (const double radius : { RADIUS, 2.5 * RADIUS })
+      {
+        const std::vector<std::size_t> expected = radiusSearch(reference, points[i], radius);
+        ASSERT_FALSE(expected.empty());
+        ASSERT_EQ(radiusSearch(*index.second, points[i], radius), expected) << index.first << ", point " << i;
+      }
+    }
+
+    // Queries away from the points
+    EXPECT_TRUE(radiusSearch(*index.second, Eigen::Vector3f(0.5f, 0.25f, 0.1f), RADIUS).empty()) << index.first;
+    EXPECT_TRUE(radiusSearch(*index.second, Eigen::Vector3f(5.0f, 5.0f, 5.0f), RADIUS).empty()) << index.first;
+  }
+}
+
+TEST(SpatialIndex, BruteForceMatchesDefinition)
+{
+  std::vector<Eigen::Vector3f> points;
+  std::vector<Eigen::Vector3f> normals;
+  sampleBoxSurface(500, points, normals);
+
+  BruteForceIndex index;
+  index.build(points);
+  for (std::size_t i = 0; i < points.size(); i += 5)
+  {
+    std::vector<std::size_t> expected;
+    for (std::size_t j = 0; j < points.size(); ++j)
+    {
+      if ((points[j] - points[i]).squaredNorm() <= RADIUS * RADIUS)
+        expected.push_back(j);
+    }
+    ASSERT_EQ(radiusSearch(index, points[i], RADIUS), expected) << "point " << i;
+  }
+}
+
+TEST(SpatialIndex, NearestKSearchesAgree)
+{
+  std::vector<Eigen::Vector3f> points;
+  std::vector<Eigen::Vector3f> normals;
+  sampleBoxSurface(2000, points, normals);
+
+  BruteForceIndex reference;
+  reference.build(points);
+  for (const auto& index : makeIndices())
+  {
+    index.second->build(points);
+    for (std::size_t i = 0; i < points.size(); i += 11)
+    {
+      for (const std::size_t k : { 1, 8, 40 })
+      {
+        const std::vector<float> expected = nearestKDistances(reference, points, points[i], k);
+        ASSERT_EQ(expected.size(), k);
+        ASSERT_EQ(nearestKDistances(*index.second, points, points[i], k), expected) << index.first << ", point " << i;
+      }
+    }
+  }
+}
+
+TEST(SpatialIndex, OrientedSearchesAgree)
+{
+  std::vector<Eigen::Vector3f> points;
+  std::vector<Eigen::Vector3f> normals;
+  sampleBoxSurface(3000, points, normals);
+
+  for (const std::string& name : { "auto", "kdtree", "brute_force", "voxel_grid" })
+  {
+    const SpatialIndexFactory factory = getSpatialIndexFactory(name, RADIUS);
+    ASSERT_TRUE(static_cast<bool>(factory)) << name;
+    OrientedSpatialIndex index(factory);
+    index.build(points, normals);
+
+    for (std::size_t i = 0; i < points.size(); i += 7)
+    {
+      for (const double max_angle : { M_PI / 4.0, M_PI })
+      {
+        std::vector<std::size_t> expected;
+        for (std::size_t j = 0; j < points.size(); ++j)
+        {
+          const double angle = std::acos(std::max(-1.0f, std::min(1.0f, normals[i].dot(normals[j]))));
+          if ((points[j] - points[i]).squaredNorm() <= RADIUS * RADIUS && angle <= max_angle + 1.0e-6)
+            expected.push_back(j);
+        }
+
+        std::vector<std::size_t> indices;
+        index.radiusSearch(points[i], normals[i], RADIUS, max_angle, indices);
+        std::sort(indices.begin(), indices.end());
+        ASSERT_EQ(indices, expected) << name << ", point " << i << ", angle " << max_angle;
+      }
+    }
+  }
+}
+
+TEST(SpatialIndex, UnknownTypeHasNoFactory)
+{
+  EXPECT_FALSE(static_cast<bool>(getSpatialIndexFactory("octree", RADIUS)));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
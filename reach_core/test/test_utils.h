@@ -0,0 +1,122 @@
+#ifndef REACH_CORE_TEST_TEST_UTILS_H
+#define REACH_CORE_TEST_TEST_UTILS_H
+
+#include <reach_core/reach_database.h>
+#include <reach_core/plugins/ik_solver_base.h>
+
+#include <boost/make_shared.hpp>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace reach
+{
+namespace core
+{
+namespace test
+{
+/**
+ * @brief IK solver of a single joint "j", which solves each target with the input rule
+ */
+class StubIKSolver : public reach::plugins::IKSolverBase
+{
+public:
+  /**
+   * @brief Computes the joint position solving the target from the seed joint position, and returns the score of the
+   * solution, or none if the target cannot be reached from the seed
+   */
+  using SolveFunction =
+      std::function<boost::optional<double>(const Eigen::Isometry3d& target, const double seed, double& solution)>;
+
+  explicit StubIKSolver(const SolveFunction& solve) : solve_(solve)
+  {
+  }
+
+  bool initialize(XmlRpc::XmlRpcValue&) override
+  {
+    return true;
+  }
+
+  boost::optional<double> solveIKFromSeed(const Eigen::Isometry3d& target, const std::map<std::string, double>& seed,
+                                          std::vector<double>& solution) override
+  {
+    double position = 0.0;
+    const boost::optional<double> score = solve_(target, seed.at("j"), position);
+    if (score)
+      solution = { position };
+    return score;
+  }
+
+  std::vector<std::string> getJointNames() const override
+  {
+    return { "j" };
+  }
+
+  reach::plugins::IKSolverBasePtr clone() const override
+  {
+    return boost::make_shared<StubIKSolver>(solve_);
+  }
+
+private:
+  SolveFunction solve_;
+};
+
+/**
+ * @brief Creates a record of the single joint "j", with the same seed and goal joint position
+ */
+inline reach_msgs::ReachRecord makeTestRecord(const std::size_t index, const double x, const double y,
+                                              const bool reached, const double joint, const double score)
+{
+  geometry_msgs::Pose goal;
+  goal.position.x = x;
+  goal.position.y = y;
+  goal.orientation.w = 1.0;
+
+  sensor_msgs::JointState state;
+  state.name = { "j" };
+  state.position = { joint };
+  return makeRecord(std::to_string(index), reached, goal, state, state, score);
+}
+
+/**
+ * @brief Database of points along the x axis, of which the points of the input indices were reached by the study at
+ * the joint value of their x coordinate. The other points have a joint value of zero
+ */
+inline ReachDatabasePtr makeLine(const std::size_t n, const double spacing, const std::vector<std::size_t>& reached)
+{
+  std::vector<bool> is_reached(n, false);
+  for (const std::size_t i : reached)
+    is_reached.at(i) = true;
+
+  auto db = std::make_shared<ReachDatabase>();
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const double x = spacing * static_cast<double>(i);
+    db->put(makeTestRecord(i, x, 0.0, is_reached[i], is_reached[i] ? x : 0.0, is_reached[i] ? 1.0 : 0.0));
+  }
+  return db;
+}
+
+/**
+ * @brief Database of reached points at random positions in a unit square
+ */
+inline ReachDatabasePtr makeRandomDatabase(const std::size_t n, const unsigned seed = 3)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  auto db = std::make_shared<ReachDatabase>();
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const double x = uniform(rng);
+    const double y = uniform(rng);
+    db->put(makeTestRecord(i, x, y, true, 0.0, 1.0));
+  }
+  return db;
+}
+
+}  // namespace test
+}  // namespace core
+}  // namespace reach
+
+#endif  // REACH_CORE_TEST_TEST_UTILS_H